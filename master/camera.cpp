@@ -1,52 +1,46 @@
-// Camera.cpp
-#include "Camera.h"
+// camera.cpp
+#include "camera.h"
+
+const uint32_t CONNECT_TIMEOUT = 1000; // Time in ms to wait for the connection
 
 /**
- * Constructor that initializes Winsock and creates a socket.
+ * Constructor that initializes the sockets and connects to the camera.
  * 
  * @param targetIp The IP address of the camera
  * @param targetPort The port of the camera
+ * 
+ * @note Check connected() before using the camera
 */
-Camera::Camera(const char* targetIp, int targetPort) : target_ip(targetIp), target_port(targetPort) {
-    // Initialize Winsock
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        std::cerr << "Failed to initialize Winsock" << std::endl;
-        // Exit the program
-        exit(EXIT_FAILURE);
-    }
-
-    // Create a socket object
-    client_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (client_socket == INVALID_SOCKET) {
-        std::cerr << "Error creating socket: " << WSAGetLastError() << std::endl;
-        // Exit the program
-        exit(EXIT_FAILURE);
+Camera::Camera(const char* targetIp, int targetPort) : target_ip(targetIp), target_port(targetPort), client_socket(INVALID_SOCKET) {
+    if (net::startup() != EXIT_SUCCESS) {
+        std::cerr << "Failed to initialize sockets" << std::endl;
+        return;
     }
 
-    // Set up the server address structure
-    sockaddr_in server_address;
-    server_address.sin_family = AF_INET;
-    server_address.sin_port = htons(target_port);
-    server_address.sin_addr.s_addr = inet_addr(target_ip);
-
     // Connect to the server
-    if (connect(client_socket, (struct sockaddr*)&server_address, sizeof(server_address)) == SOCKET_ERROR) {
-        std::cerr << "Error connecting to the server: " << WSAGetLastError() << std::endl;
-        // Exit the program
-        exit(EXIT_FAILURE);
+    client_socket = net::connectTo(target_ip, target_port, CONNECT_TIMEOUT);
+    if (client_socket == INVALID_SOCKET) {
+        std::cerr << "Error connecting to the server: " << net::lastError() << std::endl;
+        return;
     }
+    net::setNonBlocking(client_socket, false);
 }
 
 /**
- * Closes the socket and cleans up Winsock.
+ * Closes the socket and cleans up the sockets.
 */
 Camera::~Camera() {
     // Close the socket
-    closesocket(client_socket);
+    if (client_socket != INVALID_SOCKET) net::closeSocket(client_socket);
+
+    net::cleanup();
+}
 
-    // Cleanup Winsock
-    WSACleanup();
+/**
+ * @return true if the camera is connected
+*/
+bool Camera::connected() const {
+    return client_socket != INVALID_SOCKET;
 }
 
 /**
@@ -79,6 +73,44 @@ std::vector<double> Camera::splitAndConvertToDoubles(const std::string& message)
     return values;
 }
 
+/**
+ * Splits the message by semicolons into groups of x, y and angle.
+ * 
+ * @param message The message to split, any number of objects separated by semicolons
+ * 
+ * @return One detection per complete group of three values
+ * 
+ * @note Values are divided by 1000 like in splitAndConvertToDoubles, an incomplete last group is ignored
+*/
+std::vector<Detection> Camera::parseDetections(const std::string& message) {
+    std::vector<double> values;
+    std::istringstream iss(message);
+    std::string token;
+
+    while (std::getline(iss, token, ';')) {
+        // Skip the terminator and line endings the camera appends
+        if (token.find_first_of("0123456789") == std::string::npos) continue;
+        try {
+            values.push_back(std::stod(token) / 1000.0);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << "Invalid argument: " << e.what() << std::endl;
+            return {};
+        } catch (const std::out_of_range& e) {
+            std::cerr << "Out of range: " << e.what() << std::endl;
+            return {};
+        }
+    }
+
+    if (values.size() % 3 != 0) {
+        std::cerr << "Error: Incomplete object in the message" << std::endl;
+    }
+
+    std::vector<Detection> detections;
+    for (size_t i = 0; i + 2 < values.size(); i += 3) {
+        detections.push_back({values[i], values[i + 1], values[i + 2]});
+    }
+    return detections;
+}
 
 /**
  * Sends a TRG message to the camera.
@@ -88,7 +120,7 @@ void Camera::capture() {
     const char* trg_message = "TRG";
 
     // Send the message
-    send(client_socket, trg_message, strlen(trg_message) + 1, 0);
+    net::sendBytes(client_socket, trg_message, strlen(trg_message) + 1);
 
     std::cout << "Capture done" << std::endl;
 }
@@ -99,6 +131,24 @@ void Camera::capture() {
  * @return A vector of doubles
 */
 std::vector<double> Camera::receiveMessage() {
+    return splitAndConvertToDoubles(receive());
+}
+
+/**
+ * Receives a message with all objects found in one image.
+ * 
+ * @return The detected objects, empty if the camera found none
+*/
+std::vector<Detection> Camera::receiveDetections() {
+    return parseDetections(receive());
+}
+
+/**
+ * Receives one message from the camera.
+ * 
+ * @return The message as received, empty on timeout or error
+*/
+std::string Camera::receive() {
     // Setup the fd_set for select
     fd_set readSet;
     FD_ZERO(&readSet);
@@ -110,27 +160,27 @@ std::vector<double> Camera::receiveMessage() {
     timeout.tv_usec = 0; // microseconds
 
     // Use select to check if there is data to be read
-    int ready = select(0, &readSet, nullptr, nullptr, &timeout);
+    int ready = select((int)client_socket + 1, &readSet, nullptr, nullptr, &timeout);
 
     if (ready == SOCKET_ERROR) {
-        std::cerr << "Error in select: " << WSAGetLastError() << std::endl;
-        exit(EXIT_FAILURE);
+        std::cerr << "Error in select: " << net::lastError() << std::endl;
+        return std::string();
     }
 
     if (ready == 0) {
         // No data available within the timeout period
-        std::cout << "No data received within the timeout period. Exiting..." << std::endl;
-        exit(EXIT_SUCCESS);
+        std::cout << "No data received within the timeout period" << std::endl;
+        return std::string();
     }
 
     // Now, it's safe to call recv because there is data to be read
     char buffer[1024];
-    int bytesReceived = recv(client_socket, buffer, sizeof(buffer), 0);
+    int bytesReceived = net::receiveBytes(client_socket, buffer, sizeof(buffer));
 
     if (bytesReceived <= 0) {
         std::cerr << "Error receiving message or connection closed" << std::endl;
-        exit(EXIT_FAILURE);
+        return std::string();
     }
 
-    return splitAndConvertToDoubles(std::string(buffer, bytesReceived));
-}
\ No newline at end of file
+    return std::string(buffer, bytesReceived);
+}
@@ -1,29 +1,41 @@
-// Camera.h
+// camera.h
 #ifndef CAMERA_H
 #define CAMERA_H
 
-#include <WinSock2.h>
 #include <iostream>
 #include <cstring>
 #include <vector>
 #include <sstream>
 #include <stdexcept>
+#include "netsocket.h"
 
-#pragma comment(lib, "ws2_32.lib")
+/**
+ * @brief Object found by the camera, position in mm and angle in degrees
+ */
+struct Detection {
+    double x;
+    double y;
+    double angle;
+};
 
 class Camera {
     public:
         Camera(const char* targetIp, int targetPort);
         ~Camera();
 
+        bool connected() const;
         void capture();
         std::vector<double> receiveMessage();
+        std::vector<Detection> receiveDetections();
         std::vector<double> splitAndConvertToDoubles(const std::string& message);
+        static std::vector<Detection> parseDetections(const std::string& message);
 
     private:
         const char* target_ip;
         int target_port;
-        SOCKET client_socket;
+        socket_t client_socket;
+
+        std::string receive();
 };
 
 #endif // CAMERA_H
\ No newline at end of file
@@ -0,0 +1,421 @@
+// cameraclient.cpp
+#include "cameraclient.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include "cyclescheduler.h"
+
+#if defined(__linux__)
+    #include <sys/epoll.h>
+    #include <unistd.h>
+#else
+    #if !defined(_WIN32)
+        #include <sys/select.h>
+    #endif
+#endif
+
+constexpr int64_t NSEC_PER_MSEC = 1000000;
+
+/**
+ * Constructor, nothing is connected before start
+ *
+ * @param ip IPv4 address of the camera
+ * @param triggerPort Port that accepts the capture command
+ * @param resultPort Port that delivers the results
+ * @param timeout Time in ms a result may take after its trigger
+ */
+CameraClient::CameraClient(const char* ip, int triggerPort, int resultPort, uint32_t timeout)
+    : ip(ip), triggerPort(triggerPort), resultPort(resultPort), timeout(timeout) {}
+
+/**
+ * Destructor that stops the event loop and closes the connection
+ */
+CameraClient::~CameraClient(){
+    stop();
+}
+
+/**
+ * Deliver events to a function instead of the queue
+ *
+ * @param handler Called by the event loop thread, must not block
+ */
+void CameraClient::setHandler(std::function<void(const CameraEvent&)> handler){
+    this->handler = handler;
+}
+
+/**
+ * Record the triggers and their answers
+ *
+ * @param recorder Open recorder, written by the event loop thread, nullptr to stop recording
+ */
+void CameraClient::setRecorder(CameraRecorder* recorder){
+    this->recorder = recorder;
+}
+
+/**
+ * Connect both ports and start the event loop
+ *
+ * @return EXIT_SUCCESS, EXIT_FAILURE if the camera cannot be reached
+ */
+int CameraClient::start(){
+    if (running) return EXIT_SUCCESS;
+    if (net::startup() != EXIT_SUCCESS) {
+        std::cerr << "Failed to initialize sockets" << std::endl;
+        return EXIT_FAILURE;
+    }
+#if defined(__linux__)
+    poller = epoll_create1(EPOLL_CLOEXEC);
+    if (poller < 0) {
+        net::cleanup();
+        return EXIT_FAILURE;
+    }
+#endif
+    if (open() != EXIT_SUCCESS) {
+        std::cerr << "Error connecting to the camera at " << ip << std::endl;
+#if defined(__linux__)
+        ::close(poller);
+        poller = -1;
+#endif
+        net::cleanup();
+        return EXIT_FAILURE;
+    }
+    running = true;
+    loop_thread = std::thread(&CameraClient::loop, this);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Stop the event loop and close the connection, waiters return false
+ */
+void CameraClient::stop(){
+    if (!running.exchange(false)) return;
+    loop_thread.join();
+    close();
+#if defined(__linux__)
+    ::close(poller);
+    poller = -1;
+#endif
+    net::cleanup();
+
+    std::lock_guard<std::mutex> guard(waitMutex);
+    arrived.notify_all();
+}
+
+/**
+ * @return true if both ports are connected
+ */
+bool CameraClient::connected(){
+    return online;
+}
+
+/**
+ * Send the capture command
+ *
+ * The result or a timeout arrives as event carrying the returned number.
+ *
+ * @return Number of the trigger, 0 if not connected or the command could not be sent
+ */
+uint64_t CameraClient::trigger(){
+    // Sent with the terminating null, like Camera::capture
+    static const char command[] = "TRG";
+
+    std::lock_guard<std::mutex> guard(socketMutex);
+    if (!online) return 0;
+
+    // Hold the queue while sending so the result cannot be matched before the trigger is in it
+    std::lock_guard<std::mutex> queued(pendingMutex);
+    const int64_t now = CycleScheduler::now();
+    if (net::sendBytes(triggerSocket, command, sizeof(command)) != (int)sizeof(command)) return 0;
+    pending.push_back({++triggers, now});
+    return triggers;
+}
+
+/**
+ * Wait for the result of a trigger that reached the camera another way
+ *
+ * For the trigger input of the camera, the result or a timeout arrives as
+ * event like for trigger.
+ *
+ * @param time Time of CycleScheduler::now the camera was triggered, the timeout counts from here
+ *
+ * @return Number of the trigger, 0 if not connected
+ */
+uint64_t CameraClient::expect(int64_t time){
+    if (!online) return 0;
+    std::lock_guard<std::mutex> guard(pendingMutex);
+    pending.push_back({++triggers, time});
+    return triggers;
+}
+
+/**
+ * Stop waiting for the result of a trigger
+ *
+ * For an expected trigger that never reached the camera. Results are matched
+ * to the oldest trigger, left in place it would take the result of the next.
+ *
+ * @param trigger Number returned by expect or trigger
+ *
+ * @return false if the result or timeout of the trigger was already reported
+ */
+bool CameraClient::cancel(uint64_t trigger){
+    std::lock_guard<std::mutex> guard(pendingMutex);
+    for (auto it = pending.begin(); it != pending.end(); ++it) {
+        if (it->trigger == trigger) {
+            pending.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Take the next event without blocking
+ *
+ * @param event Set to the oldest event
+ *
+ * @return false if there is none
+ * @note Only one thread may call poll and wait
+ */
+bool CameraClient::poll(CameraEvent& event){
+    return events.pop(event);
+}
+
+/**
+ * Wait for the next event
+ *
+ * @param event Set to the oldest event
+ * @param timeout Time in ms to wait, 0 to wait until an event arrives or the client stops
+ *
+ * @return false on timeout or if the client stopped
+ * @note Only one thread may call poll and wait
+ */
+bool CameraClient::wait(CameraEvent& event, uint32_t timeout){
+    if (events.pop(event)) return true;
+
+    waiters++;
+    // Pairs with the fence in emit, either emit sees the waiter or the waiter sees the event
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    {
+        std::unique_lock<std::mutex> guard(waitMutex);
+        auto ready = [this]{ return events.size() > 0 || !running; };
+        if (timeout == 0) arrived.wait(guard, ready);
+        else arrived.wait_for(guard, std::chrono::milliseconds(timeout), ready);
+    }
+    waiters--;
+    return events.pop(event);
+}
+
+/**
+ * @return Number of events lost because nobody took them from the queue
+ */
+uint64_t CameraClient::getDropped(){
+    return dropped.load();
+}
+
+/**
+ * Event loop, receives results, expires triggers and reconnects
+ */
+void CameraClient::loop(){
+    int64_t nextAttempt = 0;
+    while (running) {
+        int64_t now = CycleScheduler::now();
+        if (!online && now >= nextAttempt) {
+            if (open() == EXIT_SUCCESS) {
+                CameraEvent event{CameraEvent::connected, 0, 0, now, {}};
+                emit(event);
+            } else {
+                nextAttempt = now + RECONNECT * NSEC_PER_MSEC;
+            }
+        }
+
+        // Wake up in time for the oldest trigger and an unterminated message
+        int64_t until = now + TICK * NSEC_PER_MSEC;
+        {
+            std::lock_guard<std::mutex> guard(pendingMutex);
+            if (!pending.empty()) until = std::min(until, pending.front().time + timeout * NSEC_PER_MSEC);
+        }
+        if (parser.pending()) until = std::min(until, lastByte + IDLE * NSEC_PER_MSEC);
+        const uint32_t milliseconds = (uint32_t)std::max<int64_t>(0, (until - now + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC);
+
+        bool triggerReady = false;
+        bool resultReady = false;
+        if (online) {
+            waitReadable(milliseconds, triggerReady, resultReady);
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+        }
+
+        now = CycleScheduler::now();
+        if ((triggerReady && !drain(triggerSocket, now)) || (resultReady && !drain(resultSocket, now))) {
+            close();
+            parser.reset();
+            nextAttempt = now;
+            CameraEvent event{CameraEvent::disconnected, 0, 0, now, {}};
+            emit(event);
+        }
+        if (parser.pending() && now - lastByte >= IDLE * NSEC_PER_MSEC) {
+            parser.flush([this, now](const ResultParser::Message& message) { deliver(message, now); });
+        }
+        expire(now);
+    }
+}
+
+/**
+ * Connect both ports and watch them
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int CameraClient::open(){
+    socket_t triggerConnection = net::connectTo(ip, triggerPort, CONNECT);
+    if (triggerConnection == INVALID_SOCKET) return EXIT_FAILURE;
+    socket_t resultConnection = net::connectTo(ip, resultPort, CONNECT);
+    if (resultConnection == INVALID_SOCKET) {
+        net::closeSocket(triggerConnection);
+        return EXIT_FAILURE;
+    }
+
+#if defined(__linux__)
+    epoll_event watch = {};
+    watch.events = EPOLLIN | EPOLLRDHUP;
+    watch.data.fd = triggerConnection;
+    int added = epoll_ctl(poller, EPOLL_CTL_ADD, triggerConnection, &watch);
+    watch.data.fd = resultConnection;
+    added |= epoll_ctl(poller, EPOLL_CTL_ADD, resultConnection, &watch);
+    if (added != 0) {
+        net::closeSocket(triggerConnection);
+        net::closeSocket(resultConnection);
+        return EXIT_FAILURE;
+    }
+#endif
+
+    std::lock_guard<std::mutex> guard(socketMutex);
+    triggerSocket = triggerConnection;
+    resultSocket = resultConnection;
+    online = true;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Close both ports, waiting triggers run into their timeout
+ */
+void CameraClient::close(){
+    std::lock_guard<std::mutex> guard(socketMutex);
+    online = false;
+    // Closing removes the sockets from the epoll instance as well
+    if (triggerSocket != INVALID_SOCKET) net::closeSocket(triggerSocket);
+    if (resultSocket != INVALID_SOCKET) net::closeSocket(resultSocket);
+    triggerSocket = INVALID_SOCKET;
+    resultSocket = INVALID_SOCKET;
+}
+
+/**
+ * Wait until one of the sockets can be read
+ *
+ * @param milliseconds Longest time to wait
+ * @param triggerReady Set if the trigger socket can be read or was closed
+ * @param resultReady Set if the result socket can be read or was closed
+ *
+ * @return Number of ready sockets, SOCKET_ERROR on failure
+ */
+int CameraClient::waitReadable(uint32_t milliseconds, bool& triggerReady, bool& resultReady){
+#if defined(__linux__)
+    epoll_event ready[2];
+    const int count = epoll_wait(poller, ready, 2, (int)milliseconds);
+    for (int i = 0; i < count; i++) {
+        if (ready[i].data.fd == triggerSocket) triggerReady = true;
+        if (ready[i].data.fd == resultSocket) resultReady = true;
+    }
+    return count;
+#else
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(triggerSocket, &readSet);
+    FD_SET(resultSocket, &readSet);
+    timeval wait = {(long)(milliseconds / 1000), (long)(milliseconds % 1000) * 1000};
+    const int count = select((int)std::max(triggerSocket, resultSocket) + 1, &readSet, nullptr, nullptr, &wait);
+    if (count > 0) {
+        triggerReady = FD_ISSET(triggerSocket, &readSet) != 0;
+        resultReady = FD_ISSET(resultSocket, &readSet) != 0;
+    }
+    return count;
+#endif
+}
+
+/**
+ * Read everything available on a socket
+ *
+ * Whatever arrives on the trigger port is discarded.
+ *
+ * @param socket Socket to read
+ * @param now Time of the read
+ *
+ * @return false if the connection was closed
+ */
+bool CameraClient::drain(socket_t socket, int64_t now){
+    char chunk[1024];
+    while (true) {
+        const int received = net::receiveBytes(socket, chunk, sizeof(chunk));
+        if (received == 0) return false;
+        if (received < 0) return net::wouldBlock(net::lastError());
+        if (socket != resultSocket) continue;
+
+        parser.feed(chunk, received, [this, now](const ResultParser::Message& message) { deliver(message, now); });
+        lastByte = now;
+    }
+}
+
+/**
+ * Emit a message as result of the oldest trigger
+ */
+void CameraClient::deliver(const ResultParser::Message& message, int64_t now){
+    CameraEvent event{CameraEvent::result, 0, 0, now, std::vector<Detection>(message.detections, message.detections + message.count), message.status};
+    {
+        // A result without waiting trigger is late, its trigger already timed out
+        std::lock_guard<std::mutex> guard(pendingMutex);
+        if (!pending.empty()) {
+            event.trigger = pending.front().trigger;
+            event.triggered = pending.front().time;
+            pending.pop_front();
+        }
+    }
+    event.roundTrip = std::max<int64_t>(0, net::roundTrip(triggerSocket));
+    if (recorder && event.trigger != 0) recorder->record(event.triggered, now - event.triggered, message.text, message.length);
+    emit(event);
+}
+
+/**
+ * Emit a timeout for every trigger that waited too long
+ */
+void CameraClient::expire(int64_t now){
+    std::unique_lock<std::mutex> guard(pendingMutex);
+    while (!pending.empty() && now - pending.front().time >= timeout * NSEC_PER_MSEC) {
+        CameraEvent event{CameraEvent::timeout, pending.front().trigger, pending.front().time, now, {}};
+        pending.pop_front();
+        if (recorder) recorder->record(event.triggered, -1, nullptr, 0);
+        guard.unlock();
+        emit(event);
+        guard.lock();
+    }
+}
+
+/**
+ * Hand an event to the handler or the queue
+ */
+void CameraClient::emit(CameraEvent& event){
+    if (handler) {
+        handler(event);
+        return;
+    }
+    if (!events.push(event)) {
+        dropped++;
+        return;
+    }
+    // Without it the load of waiters may pass the store of the event and a waiter misses it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters > 0) {
+        std::lock_guard<std::mutex> guard(waitMutex);
+        arrived.notify_all();
+    }
+}
@@ -0,0 +1,123 @@
+// cameraclient.h
+#ifndef CAMERACLIENT_H
+#define CAMERACLIENT_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "camera.h"
+#include "camerarecorder.h"
+#include "netsocket.h"
+#include "resultparser.h"
+#include "spscring.h"
+
+/**
+ * @brief Something that happened on the camera connection
+ */
+struct CameraEvent {
+    typedef enum {
+        result,       // Message on the result port
+        timeout,      // No result within the timeout after a trigger
+        connected,    // Both ports connected again after a disconnect
+        disconnected, // A port was closed, triggers fail until reconnected
+    }type_t;
+
+    type_t type;
+    uint64_t trigger;  // Number of the trigger the event answers, 0 if none
+    int64_t triggered; // Time the trigger was sent in ns, 0 if none
+    int64_t time;      // Time of the event in ns
+    std::vector<Detection> detections;
+    ResultParser::status_t status = ResultParser::ok; // Of the result message, ok for other events
+    int64_t roundTrip = 0; // TCP round trip of the trigger port in ns when the result arrived, 0 if unknown
+};
+
+/**
+ * @brief Non-blocking client for the trigger and result ports of the camera
+ *
+ * An event loop thread waits on both sockets (epoll on Linux, select elsewhere),
+ * feeds the result stream to a ResultParser and matches every result with the
+ * oldest trigger still waiting. A trigger that is not answered in time becomes a
+ * timeout event and a closed connection is opened again in the background, the
+ * caller decides what to do about either.
+ *
+ * Events go to the handler if one is set, otherwise into a lock-free queue that
+ * one consumer thread reads with poll or wait.
+ */
+class CameraClient {
+    public:
+        static constexpr uint32_t TICK = 10;       // Longest wait of the event loop in ms
+        static constexpr uint32_t IDLE = 20;       // Time in ms after which an unterminated message is complete
+        static constexpr uint32_t CONNECT = 250;   // Time in ms to wait for a connection
+        static constexpr uint32_t RECONNECT = 1000; // Time in ms between connection attempts
+        static constexpr size_t QUEUE = 64;        // Events kept for poll and wait
+
+        CameraClient(const char* ip, int triggerPort = 2006, int resultPort = 2005, uint32_t timeout = 1000);
+        ~CameraClient();
+
+        void setHandler(std::function<void(const CameraEvent&)> handler); // Before start, called by the event loop
+        void setRecorder(CameraRecorder* recorder); // Before start, records every trigger and its answer
+        int start();
+        void stop();
+        bool connected();
+
+        uint64_t trigger(); // Number of the trigger, 0 if it could not be sent
+        uint64_t expect(int64_t time); // Wait for a result of a trigger not sent by the client
+        bool cancel(uint64_t trigger); // Stop waiting for the result of an expected trigger that did not happen
+        bool poll(CameraEvent& event);
+        bool wait(CameraEvent& event, uint32_t timeout = 0);
+        uint64_t getDropped(); // Events lost because the queue was full
+
+    private:
+        struct Pending {
+            uint64_t trigger;
+            int64_t time;
+        };
+
+        const char* ip;
+        int triggerPort;
+        int resultPort;
+        uint32_t timeout; // Time in ms a result may take after its trigger
+
+        std::mutex socketMutex; // Guards the sockets against trigger from other threads
+        socket_t triggerSocket = INVALID_SOCKET;
+        socket_t resultSocket = INVALID_SOCKET;
+        std::atomic<bool> online{false};
+#if defined(__linux__)
+        int poller = -1; // epoll instance watching both sockets
+#endif
+
+        std::mutex pendingMutex;
+        std::deque<Pending> pending; // Triggers without result, oldest first
+        uint64_t triggers = 0;
+
+        ResultParser parser; // Event loop only
+        int64_t lastByte = 0;
+
+        std::function<void(const CameraEvent&)> handler;
+        CameraRecorder* recorder = nullptr;
+        SpscRing<CameraEvent, QUEUE> events;
+        std::atomic<uint64_t> dropped{0};
+        std::mutex waitMutex; // Only guards the wake-up of waiters
+        std::condition_variable arrived;
+        std::atomic<int> waiters{0};
+
+        std::atomic<bool> running{false};
+        std::thread loop_thread;
+
+        void loop(); // Event loop thread
+        int open();
+        void close();
+        int waitReadable(uint32_t milliseconds, bool& triggerReady, bool& resultReady);
+        bool drain(socket_t socket, int64_t now);
+        void deliver(const ResultParser::Message& message, int64_t now);
+        void expire(int64_t now);
+        void emit(CameraEvent& event);
+};
+
+#endif // CAMERACLIENT_H
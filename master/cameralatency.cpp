@@ -0,0 +1,116 @@
+// cameralatency.cpp
+#include "cameralatency.h"
+
+#include <algorithm>
+
+/**
+ * Constructor
+ *
+ * @param master Master whose cycles the times are related to, nullptr to only measure time
+ */
+CameraLatency::CameraLatency(Master* master) : master(master) {}
+
+/**
+ * Add the answer to a trigger
+ *
+ * @param event Event of the camera client
+ */
+void CameraLatency::record(const CameraEvent& event){
+    if (event.trigger == 0) return;
+    if (event.type == CameraEvent::timeout) {
+        timeouts++;
+        return;
+    }
+    if (event.type != CameraEvent::result) return;
+
+    const int64_t total = event.time - event.triggered;
+    latency.record(total);
+    if (event.roundTrip > 0) {
+        network.record(event.roundTrip);
+        processing.record(std::max<int64_t>(0, total - event.roundTrip));
+    }
+
+    if (master) {
+        const int64_t sent = master->cycleAt(event.triggered);
+        const int64_t arrived = master->cycleAt(event.time);
+        cycles.record(arrived - sent);
+        triggerCycle = sent;
+        resultCycle = arrived;
+    }
+}
+
+/**
+ * Forget all measurements
+ */
+void CameraLatency::reset(){
+    latency.reset();
+    network.reset();
+    processing.reset();
+    cycles.reset();
+    timeouts = 0;
+    triggerCycle = 0;
+    resultCycle = 0;
+}
+
+const Histogram& CameraLatency::getLatency() const {
+    return latency;
+}
+
+const Histogram& CameraLatency::getNetwork() const {
+    return network;
+}
+
+const Histogram& CameraLatency::getProcessing() const {
+    return processing;
+}
+
+uint64_t CameraLatency::getTimeouts() const {
+    return timeouts.load();
+}
+
+int64_t CameraLatency::getLastTriggerCycle() const {
+    return triggerCycle.load();
+}
+
+int64_t CameraLatency::getLastResultCycle() const {
+    return resultCycle.load();
+}
+
+/**
+ * How long before the result is needed the camera has to be triggered
+ *
+ * @param percentile Share of the results in percent that have to be in time
+ *
+ * @return Time in ns, 0 before the first result
+ */
+int64_t CameraLatency::leadTime(double percentile) const {
+    return latency.count() ? latency.percentile(percentile) : 0;
+}
+
+/**
+ * leadTime in cycles of the master, rounded up
+ *
+ * @return Number of cycles, 0 without master or before the first result
+ */
+uint32_t CameraLatency::leadCycles(double percentile) const {
+    if (!master || master->getCycleTime() == 0) return 0;
+    const int64_t period = (int64_t)master->getCycleTime() * 1000;
+    return (uint32_t)((leadTime(percentile) + period - 1) / period);
+}
+
+/**
+ * Write the statistics as CSV, times in nanoseconds
+ *
+ * @param out Stream to write to
+ */
+void CameraLatency::dumpSummary(std::ostream& out) const {
+    out << "metric,count,min,mean,p50,p90,p99,max\n";
+    const std::pair<const char*, const Histogram*> rows[] = {
+        {"latency", &latency}, {"network", &network}, {"processing", &processing}, {"cycles", &cycles}};
+    for (const auto& row : rows) {
+        const Histogram& h = *row.second;
+        out << row.first << "," << h.count() << "," << h.min() << "," << h.mean() << "," << h.percentile(50) << ","
+            << h.percentile(90) << "," << h.percentile(99) << "," << h.max() << "\n";
+    }
+    out << "timeouts," << timeouts.load() << ",,,,,,\n";
+}
@@ -0,0 +1,52 @@
+// cameralatency.h
+#ifndef CAMERALATENCY_H
+#define CAMERALATENCY_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include "cameraclient.h"
+#include "master.h"
+#include "metrics.h"
+
+/**
+ * @brief Time from the camera trigger to its result, split into network and camera
+ *
+ * Trigger and result carry times of the monotonic clock the cycle thread runs
+ * on. The network share is the TCP round trip of the trigger port, the command
+ * goes out on one connection and the result comes back on the other. The rest
+ * is the camera taking and processing the image. With a master the times are
+ * also counted in EtherCAT cycles, so a capture can be planned that many cycles
+ * ahead of the moment its result is needed.
+ */
+class CameraLatency {
+    public:
+        CameraLatency(Master* master = nullptr);
+
+        void record(const CameraEvent& event); // Results and timeouts of a trigger, other events are ignored
+        void reset();
+
+        const Histogram& getLatency() const;    // Trigger to result in ns
+        const Histogram& getNetwork() const;    // Round trip in ns
+        const Histogram& getProcessing() const; // Latency without the round trip in ns
+        uint64_t getTimeouts() const;
+        int64_t getLastTriggerCycle() const; // Cycle the last answered trigger was sent in, 0 without master
+        int64_t getLastResultCycle() const;  // Cycle its result arrived in
+
+        int64_t leadTime(double percentile = 99) const; // Time in ns to trigger ahead of needing the result
+        uint32_t leadCycles(double percentile = 99) const;
+
+        void dumpSummary(std::ostream& out) const;
+
+    private:
+        Master* master;
+        Histogram latency;
+        Histogram network;
+        Histogram processing;
+        Histogram cycles; // Latency in whole cycles
+        std::atomic<uint64_t> timeouts{0};
+        std::atomic<int64_t> triggerCycle{0};
+        std::atomic<int64_t> resultCycle{0};
+};
+
+#endif // CAMERALATENCY_H
@@ -0,0 +1,123 @@
+// camerarecorder.cpp
+#include "camerarecorder.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+const char RECORDING_MAGIC[4] = {'C', 'R', 'E', 'C'};
+const uint32_t RECORDING_VERSION = 1;
+const uint32_t MAX_PAYLOAD = 1 << 20; // Larger sizes mean a damaged file
+
+/**
+ * Constructor for a recorder that records nothing until opened
+ */
+CameraRecorder::CameraRecorder() : origin(0), records(0) {}
+
+/**
+ * Destructor that completes the file
+ */
+CameraRecorder::~CameraRecorder(){
+    close();
+}
+
+/**
+ * Start a recording, replacing the file
+ *
+ * Every record is flushed to the file when it is added.
+ *
+ * @param path File to write
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int CameraRecorder::open(const std::string& path){
+    std::lock_guard<std::mutex> guard(lock);
+    if (file.is_open()) file.close();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Error: Cannot write camera recording " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    Header header;
+    std::memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+    header.version = RECORDING_VERSION;
+    file.write((const char*)&header, sizeof(header));
+    origin = 0;
+    records = 0;
+    return file.good() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Complete the recording
+ */
+void CameraRecorder::close(){
+    std::lock_guard<std::mutex> guard(lock);
+    if (file.is_open()) file.close();
+}
+
+/**
+ * @return true while recording
+ */
+bool CameraRecorder::isOpen(){
+    std::lock_guard<std::mutex> guard(lock);
+    return file.is_open();
+}
+
+/**
+ * Add a trigger and its answer
+ *
+ * @param triggered Time of the trigger from CycleScheduler::now
+ * @param latency Time from trigger to result in ns, -1 if the camera did not answer
+ * @param payload Result message without its delimiter
+ * @param size Bytes of the payload
+ */
+void CameraRecorder::record(int64_t triggered, int64_t latency, const char* payload, size_t size){
+    std::lock_guard<std::mutex> guard(lock);
+    if (!file.is_open()) return;
+    if (records == 0) origin = triggered;
+
+    const Entry entry = {triggered - origin, latency, (uint32_t)size, 0};
+    file.write((const char*)&entry, sizeof(entry));
+    if (size) file.write(payload, size);
+    // A record per image, flushing keeps everything up to a kill of the process
+    file.flush();
+    records++;
+}
+
+/**
+ * @return Number of records written since open
+ */
+uint64_t CameraRecorder::getRecords(){
+    std::lock_guard<std::mutex> guard(lock);
+    return records;
+}
+
+/**
+ * Read a recording
+ *
+ * @param path File to read
+ * @param records Set to the records of the file
+ *
+ * @return EXIT_SUCCESS, EXIT_FAILURE if the file is missing or damaged, records holds the intact part then
+ */
+int CameraRecorder::load(const std::string& path, std::vector<CameraRecord>& records){
+    records.clear();
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return EXIT_FAILURE;
+
+    Header header;
+    if (!file.read((char*)&header, sizeof(header)) || std::memcmp(header.magic, RECORDING_MAGIC, sizeof(header.magic)) != 0
+        || header.version != RECORDING_VERSION) {
+        return EXIT_FAILURE;
+    }
+
+    Entry entry;
+    while (file.read((char*)&entry, sizeof(entry))) {
+        if (entry.size > MAX_PAYLOAD) return EXIT_FAILURE;
+        CameraRecord record = {entry.triggered, entry.latency, std::string(entry.size, '\0')};
+        if (entry.size && !file.read(&record.payload[0], entry.size)) return EXIT_FAILURE;
+        records.push_back(std::move(record));
+    }
+    // A partial entry at the end is a recording that was cut off
+    return file.gcount() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,61 @@
+// camerarecorder.h
+#ifndef CAMERARECORDER_H
+#define CAMERARECORDER_H
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One trigger and its answer, as recorded
+ */
+struct CameraRecord {
+    int64_t triggered;   // Time of the trigger in ns since the first trigger of the recording
+    int64_t latency;     // Time from trigger to result in ns, -1 if the camera did not answer
+    std::string payload; // Result message without its delimiter
+};
+
+/**
+ * @brief Writes camera triggers and results to a compact binary file
+ *
+ * The file starts with a header followed by one record per trigger: a fixed
+ * part with the times and the payload size, then the payload as received. A
+ * recording is played back by camerasim over the same two ports as the camera,
+ * or read with load to feed a parser offline.
+ */
+class CameraRecorder {
+    public:
+        CameraRecorder();
+        ~CameraRecorder();
+
+        int open(const std::string& path);
+        void close();
+        bool isOpen();
+
+        void record(int64_t triggered, int64_t latency, const char* payload, size_t size);
+        uint64_t getRecords();
+
+        static int load(const std::string& path, std::vector<CameraRecord>& records);
+
+    private:
+        struct Header {
+            char magic[4];
+            uint32_t version;
+        };
+
+        struct Entry {
+            int64_t triggered;
+            int64_t latency;
+            uint32_t size;
+            uint32_t reserved;
+        };
+
+        std::mutex lock; // The event loop records, other threads open and close
+        std::ofstream file;
+        int64_t origin; // Time of the first trigger on the monotonic clock
+        uint64_t records;
+};
+
+#endif // CAMERARECORDER_H
@@ -0,0 +1,188 @@
+// camerasim.cpp
+// Stand-in for the camera: answers TRG on the trigger port with random or recorded objects on the result port
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "camerarecorder.h"
+#include "netsocket.h"
+
+#if !defined(_WIN32)
+    #include <sys/select.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Behaviour of the stand-in, set from the command line
+ */
+struct Settings {
+    int triggerPort = 2006;
+    int resultPort = 2005;
+    int delay = 50;   // Time in ms from trigger to result
+    int objects = 3;  // Objects per image
+    int miss = 0;     // Leave every n-th trigger unanswered, 0 to answer all
+    std::string replay; // Recording to answer with instead of random objects
+    double speed = 1; // Replay rate, 2 answers twice as fast as recorded, 0 answers at once
+};
+
+/**
+ * @brief Result to send at a time
+ */
+struct Answer {
+    Clock::time_point time;
+    std::string message;
+};
+
+/**
+ * Take a new connection, replacing the previous client
+ */
+void acceptClient(socket_t server, socket_t& client, const char* name){
+    socket_t accepted = accept(server, nullptr, nullptr);
+    if (accepted == INVALID_SOCKET) return;
+    if (client != INVALID_SOCKET) net::closeSocket(client);
+    client = accepted;
+    net::setNoDelay(client);
+    std::cout << "Client connected on the " << name << " port" << std::endl;
+}
+
+/**
+ * Result message like the camera sends it, values in thousandths separated by semicolons
+ */
+std::string result(int objects, std::mt19937& random){
+    std::uniform_int_distribution<int> x(300000, 450000);
+    std::uniform_int_distribution<int> y(-120000, 120000);
+    std::uniform_int_distribution<int> angle(-90000, 90000);
+    std::string message;
+    for (int i = 0; i < objects; i++) {
+        message += std::to_string(x(random)) + ";" + std::to_string(y(random)) + ";" + std::to_string(angle(random)) + ";";
+    }
+    return message + "\r\n";
+}
+
+int main(int argc, char* argv[]){
+    Settings settings;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        const int value = std::atoi(argv[i + 1]);
+        if (option == "--trigger") settings.triggerPort = value;
+        else if (option == "--result") settings.resultPort = value;
+        else if (option == "--delay") settings.delay = value;
+        else if (option == "--objects") settings.objects = value;
+        else if (option == "--miss") settings.miss = value;
+        else if (option == "--replay") settings.replay = argv[i + 1];
+        else if (option == "--speed") settings.speed = std::atof(argv[i + 1]);
+        else {
+            std::cout << "Usage: camerasim [--trigger 2006] [--result 2005] [--delay ms] [--objects n] [--miss n]"
+                      << " [--replay file] [--speed x]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<CameraRecord> recording;
+    if (!settings.replay.empty()) {
+        if (CameraRecorder::load(settings.replay, recording) != EXIT_SUCCESS && recording.empty()) {
+            std::cerr << "Error reading camera recording " << settings.replay << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Replaying " << recording.size() << " results of " << settings.replay << " at speed " << settings.speed << std::endl;
+    }
+
+    if (net::startup() != EXIT_SUCCESS) return EXIT_FAILURE;
+    socket_t triggerServer = net::listenOn(settings.triggerPort);
+    socket_t resultServer = net::listenOn(settings.resultPort);
+    if (triggerServer == INVALID_SOCKET || resultServer == INVALID_SOCKET) {
+        std::cerr << "Error listening on ports " << settings.triggerPort << " and " << settings.resultPort << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Camera stand-in on ports " << settings.triggerPort << " and " << settings.resultPort << std::endl;
+
+    socket_t triggerClient = INVALID_SOCKET;
+    socket_t resultClient = INVALID_SOCKET;
+    std::deque<Answer> due; // Results still to send, in the order of the triggers
+    std::string received;
+    uint64_t triggers = 0;
+    std::mt19937 random(2006);
+
+    while (true) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(triggerServer, &readSet);
+        FD_SET(resultServer, &readSet);
+        socket_t highest = triggerServer > resultServer ? triggerServer : resultServer;
+        if (triggerClient != INVALID_SOCKET) {
+            FD_SET(triggerClient, &readSet);
+            if (triggerClient > highest) highest = triggerClient;
+        }
+        if (resultClient != INVALID_SOCKET) {
+            FD_SET(resultClient, &readSet);
+            if (resultClient > highest) highest = resultClient;
+        }
+
+        // Wake up for the next result at the latest
+        long wait = 100;
+        if (!due.empty()) {
+            const long left = (long)std::chrono::duration_cast<std::chrono::milliseconds>(due.front().time - Clock::now()).count();
+            wait = left < 0 ? 0 : (left < wait ? left : wait);
+        }
+        timeval timeout = {wait / 1000, (wait % 1000) * 1000};
+        if (select((int)highest + 1, &readSet, nullptr, nullptr, &timeout) == SOCKET_ERROR) {
+            std::cerr << "Error in select: " << net::lastError() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (FD_ISSET(triggerServer, &readSet)) acceptClient(triggerServer, triggerClient, "trigger");
+        if (FD_ISSET(resultServer, &readSet)) acceptClient(resultServer, resultClient, "result");
+
+        if (triggerClient != INVALID_SOCKET && FD_ISSET(triggerClient, &readSet)) {
+            char buffer[256];
+            const int count = net::receiveBytes(triggerClient, buffer, sizeof(buffer));
+            if (count <= 0) {
+                net::closeSocket(triggerClient);
+                triggerClient = INVALID_SOCKET;
+                std::cout << "Trigger client disconnected" << std::endl;
+            } else {
+                // Commands may arrive split or several at once
+                received.append(buffer, count);
+                size_t found;
+                while ((found = received.find("TRG")) != std::string::npos) {
+                    received.erase(0, found + 3);
+                    triggers++;
+                    if (settings.miss > 0 && triggers % settings.miss == 0) continue;
+                    if (recording.empty()) {
+                        due.push_back({Clock::now() + std::chrono::milliseconds(settings.delay), result(settings.objects, random)});
+                        continue;
+                    }
+
+                    // The recording starts over at its end, a recorded timeout stays unanswered
+                    const CameraRecord& record = recording[(triggers - 1) % recording.size()];
+                    if (record.latency < 0) continue;
+                    const int64_t latency = settings.speed > 0 ? (int64_t)(record.latency / settings.speed) : 0;
+                    Clock::time_point time = Clock::now() + std::chrono::nanoseconds(latency);
+                    // Like the camera, answer in the order of the triggers
+                    if (!due.empty() && due.back().time > time) time = due.back().time;
+                    due.push_back({time, record.payload + "\n"});
+                }
+                if (received.size() > 2) received.erase(0, received.size() - 2);
+            }
+        }
+
+        // The client never sends on the result port, readable means closed
+        if (resultClient != INVALID_SOCKET && FD_ISSET(resultClient, &readSet)) {
+            char buffer[256];
+            if (net::receiveBytes(resultClient, buffer, sizeof(buffer)) <= 0) {
+                net::closeSocket(resultClient);
+                resultClient = INVALID_SOCKET;
+                std::cout << "Result client disconnected" << std::endl;
+            }
+        }
+
+        while (!due.empty() && due.front().time <= Clock::now()) {
+            if (resultClient != INVALID_SOCKET) net::sendBytes(resultClient, due.front().message.data(), due.front().message.size());
+            due.pop_front();
+        }
+    }
+}
@@ -0,0 +1,173 @@
+// cyclescheduler.cpp
+#include "cyclescheduler.h"
+
+#include <chrono>
+#include <cstdlib>
+
+#if defined(__linux__)
+    #include <time.h>
+    #include <errno.h>
+    #include <pthread.h>
+    #include <sched.h>
+#elif defined(_WIN32)
+    #include <windows.h>
+    #pragma comment(lib, "winmm.lib")
+#endif
+
+constexpr int64_t NSEC_PER_SEC = 1000000000;
+
+/**
+ * Constructor for the cycle scheduler
+ *
+ * @param cycletime Cycle time in microseconds
+ */
+CycleScheduler::CycleScheduler(uint32_t cycletime) : period((int64_t)cycletime * 1000), next(0), cycles(0), overruns(0) {
+#if defined(_WIN32)
+    // Default timer resolution on Windows is 15.6 ms, far above any usable cycle time
+    timeBeginPeriod(1);
+#endif
+}
+
+/**
+ * Destructor for the cycle scheduler
+ */
+CycleScheduler::~CycleScheduler() {
+#if defined(_WIN32)
+    timeEndPeriod(1);
+#endif
+}
+
+/**
+ * Anchor the deadline grid to the current time
+ *
+ * @note Call once from the thread that runs the loop, right before the first cycle
+ */
+void CycleScheduler::start() {
+    this->next = now();
+}
+
+/**
+ * Sleep until the next absolute deadline
+ *
+ * If the deadline has already passed the cycle is counted as overrun and the
+ * deadline is moved forward by whole periods, so the loop keeps its phase.
+ *
+ * @return true if the deadline was met, false on overrun
+ */
+bool CycleScheduler::waitNext() {
+    bool onTime = true;
+    this->next += this->period;
+
+    const int64_t current = now();
+    if (current > this->next){
+        const int64_t missed = (current - this->next) / this->period + 1;
+        this->next += missed * this->period;
+        overruns.fetch_add(1, std::memory_order_relaxed);
+        onTime = false;
+    }
+
+    sleepUntil(this->next);
+    cycles.fetch_add(1, std::memory_order_relaxed);
+    return onTime;
+}
+
+/**
+ * Move the deadline grid by a number of nanoseconds
+ *
+ * @param ns Offset in nanoseconds, positive delays the next wake-up
+ */
+void CycleScheduler::shift(int64_t ns) {
+    this->next += ns;
+}
+
+/**
+ * @return Absolute deadline of the upcoming cycle in nanoseconds
+ */
+int64_t CycleScheduler::deadline() const {
+    return this->next;
+}
+
+/**
+ * @return Number of completed cycles
+ */
+uint64_t CycleScheduler::getCycles() const {
+    return cycles.load(std::memory_order_relaxed);
+}
+
+/**
+ * @return Number of cycles that missed their deadline
+ */
+uint64_t CycleScheduler::getOverruns() const {
+    return overruns.load(std::memory_order_relaxed);
+}
+
+/**
+ * Current time of the monotonic clock used for all deadlines
+ *
+ * @return Time in nanoseconds
+ */
+int64_t CycleScheduler::now() {
+#if defined(__linux__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * Sleep until an absolute point in time
+ *
+ * @param ns Absolute time in nanoseconds of the clock used by @see now
+ */
+void CycleScheduler::sleepUntil(int64_t ns) {
+#if defined(__linux__)
+    struct timespec ts;
+    ts.tv_sec = ns / NSEC_PER_SEC;
+    ts.tv_nsec = ns % NSEC_PER_SEC;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#else
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(ns)));
+#endif
+}
+
+/**
+ * Give a running thread real-time priority and optionally pin it to one CPU
+ *
+ * Same scheduling policy as osal_thread_create_rt (SCHED_FIFO), but applied to an
+ * already created std::thread.
+ *
+ * @param thread Thread to configure
+ * @param priority SCHED_FIFO priority (1-99), 0 keeps the default scheduling
+ * @param cpu CPU to pin the thread to, -1 to allow all CPUs
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ * @note Needs root or CAP_SYS_NICE on Linux
+ */
+int CycleScheduler::makeRealtime(std::thread& thread, int priority, int cpu) {
+    int retval = EXIT_SUCCESS;
+#if defined(__linux__)
+    if (priority > 0){
+        struct sched_param schparam = {};
+        schparam.sched_priority = priority;
+        if (pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &schparam) != 0) retval = EXIT_FAILURE;
+    }
+    if (cpu >= 0){
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+        if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpuset), &cpuset) != 0) retval = EXIT_FAILURE;
+    }
+#elif defined(_WIN32)
+    if (priority > 0){
+        if (!SetThreadPriority(thread.native_handle(), THREAD_PRIORITY_TIME_CRITICAL)) retval = EXIT_FAILURE;
+    }
+    if (cpu >= 0){
+        if (!SetThreadAffinityMask(thread.native_handle(), (DWORD_PTR)1 << cpu)) retval = EXIT_FAILURE;
+    }
+#else
+    if (priority > 0 || cpu >= 0) retval = EXIT_FAILURE;
+#endif
+    return retval;
+}
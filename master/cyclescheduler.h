@@ -0,0 +1,41 @@
+// cyclescheduler.h
+#ifndef CYCLESCHEDULER_H
+#define CYCLESCHEDULER_H
+
+#include <cstdint>
+#include <atomic>
+#include <thread>
+
+/**
+ * @brief Paces a periodic loop on absolute deadlines of a monotonic clock
+ *
+ * Every wake-up is computed as start + n * period, so oversleeping in one cycle
+ * does not shift the following ones. Missed deadlines are counted as overruns and
+ * skipped while keeping the original phase.
+ */
+class CycleScheduler {
+    public:
+        CycleScheduler(uint32_t cycletime);
+        ~CycleScheduler();
+
+        void start();
+        bool waitNext();
+        void shift(int64_t ns);
+
+        int64_t deadline() const;
+        uint64_t getCycles() const;
+        uint64_t getOverruns() const;
+
+        static int64_t now();
+        static int makeRealtime(std::thread& thread, int priority, int cpu);
+
+    private:
+        int64_t period; // Cycle time in nanoseconds
+        int64_t next;   // Absolute deadline of the next cycle in nanoseconds
+        std::atomic<uint64_t> cycles;
+        std::atomic<uint64_t> overruns;
+
+        static void sleepUntil(int64_t ns);
+};
+
+#endif // CYCLESCHEDULER_H
@@ -0,0 +1,58 @@
+// dcsync.cpp
+#include "dcsync.h"
+
+/**
+ * Constructor for the DC synchronisation controller
+ *
+ * @param cycletime Cycle time in microseconds, equal to the SYNC0 cycle
+ * @param sendOffset Time in ns between SYNC0 and the moment the frame should pass
+ */
+DcSync::DcSync(uint32_t cycletime, int64_t sendOffset) : period((int64_t)cycletime * 1000), sendOffset(sendOffset) {
+    reset();
+}
+
+/**
+ * Forget the controller history, used when DC synchronisation is (re)started
+ */
+void DcSync::reset(){
+    this->integral = 0;
+    this->offset = 0;
+    this->drift = 0;
+}
+
+/**
+ * Calculate the correction for the next cycle
+ *
+ * Same controller as ec_sync in the SOEM red_test sample: proportional gain 1/100
+ * and an integral of the error sign with gain 1/20.
+ *
+ * @param dcTime DC reference time of the last frame (ec_DCtime) in ns
+ *
+ * @return Time in ns to add to the next deadline
+ */
+int64_t DcSync::update(int64_t dcTime){
+    int64_t delta = (dcTime - this->sendOffset) % this->period;
+    if (delta > this->period / 2) delta -= this->period;
+    if (delta < -this->period / 2) delta += this->period;
+
+    if (delta > 0) this->integral++;
+    if (delta < 0) this->integral--;
+
+    this->offset = delta;
+    this->drift = -(this->integral / 20);
+    return -(delta / 100) + this->drift;
+}
+
+/**
+ * @return Phase error of the last cycle in ns
+ */
+int64_t DcSync::getOffset() const {
+    return this->offset;
+}
+
+/**
+ * @return Drift correction between host and DC reference clock in ns per cycle
+ */
+int64_t DcSync::getDrift() const {
+    return this->drift;
+}
@@ -0,0 +1,33 @@
+// dcsync.h
+#ifndef DCSYNC_H
+#define DCSYNC_H
+
+#include <cstdint>
+
+/**
+ * @brief PI controller that aligns the master cycle to the distributed clock
+ *
+ * Measures the phase of the DC reference time within the cycle at the moment the
+ * frame returns and calculates a correction for the next deadline, so frames are
+ * sent a fixed time before SYNC0. The proportional part removes the phase error,
+ * the integral part follows the drift between the host clock and the reference clock.
+ */
+class DcSync {
+    public:
+        DcSync(uint32_t cycletime, int64_t sendOffset);
+
+        int64_t update(int64_t dcTime);
+        void reset();
+
+        int64_t getOffset() const;
+        int64_t getDrift() const;
+
+    private:
+        int64_t period;     // Cycle time in ns
+        int64_t sendOffset; // Wanted distance between SYNC0 and the frame in ns
+        int64_t integral;   // Sum of the sign of the phase error
+        int64_t offset;     // Last phase error in ns
+        int64_t drift;      // Integral correction in ns per cycle
+};
+
+#endif // DCSYNC_H
@@ -0,0 +1,131 @@
+// hardwaretrigger.cpp
+#include "hardwaretrigger.h"
+
+#include <chrono>
+
+/**
+ * Constructor that watches the cycles for pulses to fire
+ *
+ * The output has to be enabled in the bitmask 0x60FE:02 of the slave.
+ *
+ * @param master EtherCAT master running the cycle
+ * @param slaveNr Slave with the camera trigger on its digital outputs
+ * @param output Bit of the camera trigger on the digital outputs
+ * @param pulseCycles Cycles the output stays on
+ */
+HardwareTrigger::HardwareTrigger(Master& master, int slaveNr, uint32_t output, uint32_t pulseCycles)
+    : master(master), slaveNr(slaveNr), output(output), pulseCycles(pulseCycles ? pulseCycles : 1) {
+    hook = master.addCycleHook([this]() { update(); });
+}
+
+/**
+ * Destructor that stops watching the cycles and switches the output off
+ *
+ * @note Nobody may wait in wait anymore
+ */
+HardwareTrigger::~HardwareTrigger(){
+    master.removeCycleHook(hook);
+    if (high) {
+        // Let the cycle thread merge the rising edge first, it would win over this
+        master.waitCycle();
+        master.setOutputs(slaveNr, 0, output);
+    }
+}
+
+/**
+ * Start a pulse in a cycle
+ *
+ * The output is staged by the cycle before, so the earliest cycle is the one
+ * after the next.
+ *
+ * @param cycle Number of the cycle whose frame carries the rising edge, 0 for the earliest
+ *
+ * @return Cycle the pulse is planned for, 0 if the previous pulse is still under way
+ * @see Master::cycleAt to find the cycle of a point in time
+ */
+int64_t HardwareTrigger::fire(int64_t cycle){
+    if (busy.exchange(true)) return 0;
+    const int64_t earliest = (int64_t)master.getLastCycle().cycle + 2;
+    if (cycle < earliest) cycle = earliest;
+    requested++;
+    planned = cycle;
+    return cycle;
+}
+
+/**
+ * Wait until the last fired pulse went out
+ *
+ * @param stamp Set to the stamp of the cycle whose frame carried the rising edge
+ * @param timeout Time in ms to wait, 0 to wait without limit
+ *
+ * @return false on timeout, the master stopped cycling then
+ */
+bool HardwareTrigger::wait(CycleStamp& stamp, uint32_t timeout){
+    std::unique_lock<std::mutex> guard(stampMutex);
+    auto done = [this]{ return pulses.load() >= requested.load(); };
+    waiters++;
+    bool started = true;
+    if (timeout == 0) stamped.wait(guard, done);
+    else started = stamped.wait_for(guard, std::chrono::milliseconds(timeout), done);
+    waiters--;
+    stamp = last;
+    return started;
+}
+
+/**
+ * @return Stamp of the cycle the last pulse started in, cycle 0 before the first pulse
+ */
+CycleStamp HardwareTrigger::getLast(){
+    std::lock_guard<std::mutex> guard(stampMutex);
+    return last;
+}
+
+/**
+ * @return Number of pulses started
+ */
+uint64_t HardwareTrigger::getPulses(){
+    return pulses.load();
+}
+
+/**
+ * Switch the output for the cycle after this one and note the cycle of the rising edge
+ */
+void HardwareTrigger::update(){
+    const CycleStamp now = master.getLastCycle();
+    if (high) {
+        // Hooks are skipped while hooks are added or removed, the stamp is then of a later cycle
+        if (rising.cycle == 0 && (int64_t)now.cycle >= start) rising = now;
+        if ((int64_t)now.cycle >= start + (int64_t)pulseCycles - 1) {
+            master.cycleOutputs(slaveNr, 0, output);
+            high = false;
+        }
+    }
+
+    if (rising.cycle != 0 && !noted) {
+        // Only tried, while a waiter holds the mutex the stamp is handed over next cycle
+        std::unique_lock<std::mutex> guard(stampMutex, std::try_to_lock);
+        if (guard.owns_lock()) {
+            last = rising;
+            pulses++;
+            noted = true;
+            guard.unlock();
+            if (waiters > 0) stamped.notify_all();
+        }
+    }
+    if (high || !noted) return;
+    if (rising.cycle != 0) {
+        // Pulse over and its stamp handed over
+        rising = {};
+        busy = false;
+    }
+
+    const int64_t cycle = planned.load();
+    if (cycle != 0 && (int64_t)now.cycle + 1 >= cycle) {
+        // Staged now, the output goes out with the next frame
+        master.cycleOutputs(slaveNr, output, 0);
+        high = true;
+        noted = false;
+        start = (int64_t)now.cycle + 1;
+        planned = 0;
+    }
+}
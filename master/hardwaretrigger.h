@@ -0,0 +1,55 @@
+// hardwaretrigger.h
+#ifndef HARDWARETRIGGER_H
+#define HARDWARETRIGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include "master.h"
+
+/**
+ * @brief Triggers the camera with a digital output of a drive in a chosen cycle
+ *
+ * The output is part of the process data, so the pulse starts with the frame of
+ * the chosen cycle instead of whenever the host gets to send a TCP command. The
+ * stamp of that cycle, with the DC time the frame passed the reference clock,
+ * is kept to correlate the image with the arm position.
+ */
+class HardwareTrigger {
+    public:
+        static constexpr uint32_t PULSE_CYCLES = 2; // Cycles the output stays on
+
+        HardwareTrigger(Master& master, int slaveNr, uint32_t output, uint32_t pulseCycles = PULSE_CYCLES);
+        ~HardwareTrigger();
+
+        int64_t fire(int64_t cycle = 0); // Cycle the pulse starts in, 0 if a pulse is under way
+        bool wait(CycleStamp& stamp, uint32_t timeout = 0);
+        CycleStamp getLast(); // Stamp of the last pulse
+        uint64_t getPulses();
+
+    private:
+        Master& master;
+        int slaveNr;
+        uint32_t output;  // Bit of the camera trigger on the digital outputs
+        uint32_t pulseCycles;
+        int hook;         // Id of the cycle hook
+
+        std::atomic<int64_t> planned{0}; // Cycle the next pulse starts in, 0 if none
+        std::atomic<uint64_t> requested{0}; // Pulses fired
+        std::atomic<bool> busy{false};   // From fire until the output is off again
+        int64_t start = 0;               // Cycle the current pulse started in, cycle thread only
+        bool high = false;               // Cycle thread only
+        bool noted = true;               // Stamp of the current pulse handed to waiters, cycle thread only
+        CycleStamp rising = {};          // Stamp of the current pulse, cycle thread only
+
+        std::mutex stampMutex;
+        std::condition_variable stamped;
+        CycleStamp last = {};
+        std::atomic<uint64_t> pulses{0}; // Pulses started, written under stampMutex
+        std::atomic<int> waiters{0};
+
+        void update(); // Called by the cycle thread
+};
+
+#endif // HARDWARETRIGGER_H
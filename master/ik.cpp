@@ -0,0 +1,199 @@
+// ik.cpp
+#include "ik.h"
+
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IK_SSE
+#include <emmintrin.h>
+#endif
+
+namespace ik {
+
+// Abramowitz and Stegun 4.4.49, atan(t) for 0 <= t <= 1 with an error below 1e-5 rad
+constexpr float ATAN_C1 = 0.9998660f;
+constexpr float ATAN_C3 = -0.3302995f;
+constexpr float ATAN_C5 = 0.1801410f;
+constexpr float ATAN_C7 = -0.0851330f;
+constexpr float ATAN_C9 = 0.0208351f;
+
+constexpr float HALF_PI = 1.57079632679f;
+constexpr float PI = 3.14159265359f;
+constexpr float DEGREES = 57.2957795131f; // Degrees per radian
+
+/**
+ * Resize all arrays
+ *
+ * @param n Number of poses
+ */
+void Batch::resize(size_t n){
+    j1Left.resize(n);
+    j2Left.resize(n);
+    gripperLeft.resize(n);
+    j1Right.resize(n);
+    j2Right.resize(n);
+    gripperRight.resize(n);
+    reachable.resize(n);
+}
+
+/**
+ * @return Number of poses
+ */
+size_t Batch::size() const {
+    return reachable.size();
+}
+
+/**
+ * Polynomial atan2
+ *
+ * The ratio of the smaller to the larger component goes through the polynomial,
+ * the octant is restored from the signs and the order of the components.
+ *
+ * @return Angle in radians between -pi and pi, off by at most ATAN_ERROR
+ */
+float atan2Fast(float y, float x){
+    const float ax = std::fabs(x);
+    const float ay = std::fabs(y);
+    const float hi = ax > ay ? ax : ay;
+    const float lo = ax > ay ? ay : ax;
+    const float t = lo / (hi > FLT_MIN ? hi : FLT_MIN);
+    const float t2 = t * t;
+
+    float r = ((((ATAN_C9 * t2 + ATAN_C7) * t2 + ATAN_C5) * t2 + ATAN_C3) * t2 + ATAN_C1) * t;
+    if (ay > ax) r = HALF_PI - r;
+    if (x < 0) r = PI - r;
+    return std::signbit(y) ? -r : r;
+}
+
+/**
+ * Inverse kinematics of a range of poses without vector instructions
+ *
+ * @param a1 Length of the first arm
+ * @param a2 Length of the second arm
+ * @param x X coordinates
+ * @param y Y coordinates
+ * @param angle Object angles in degrees
+ * @param first First pose to solve
+ * @param n Number of poses in the arrays
+ * @param out Results, sized to n by the caller
+ */
+void solveScalar(float a1, float a2, const float* x, const float* y, const float* angle, size_t first, size_t n, Batch& out){
+    const float k0 = a1 * a1 + a2 * a2;
+    const float inv = 1.0f / (2 * a1 * a2);
+
+    for (size_t i = first; i < n; i++){
+        const float c2 = (x[i] * x[i] + y[i] * y[i] - k0) * inv;
+        const bool ok = c2 >= -1.0f && c2 <= 1.0f;
+        out.reachable[i] = ok;
+        if (!ok){
+            out.j1Left[i] = out.j2Left[i] = out.gripperLeft[i] = 0;
+            out.j1Right[i] = out.j2Right[i] = out.gripperRight[i] = 0;
+            continue;
+        }
+
+        const float s2 = std::sqrt(1.0f - c2 * c2);
+        const float j2 = atan2Fast(s2, c2);
+        const float base = atan2Fast(y[i], x[i]);
+        const float offset = atan2Fast(a2 * s2, a1 + a2 * c2);
+
+        out.j1Right[i] = (base - offset) * DEGREES;
+        out.j2Right[i] = j2 * DEGREES;
+        out.gripperRight[i] = out.j1Right[i] + out.j2Right[i] - angle[i];
+        out.j1Left[i] = (base + offset) * DEGREES;
+        out.j2Left[i] = -j2 * DEGREES;
+        out.gripperLeft[i] = out.j1Left[i] + out.j2Left[i] - angle[i];
+    }
+}
+
+#ifdef IK_SSE
+static inline __m128 select(__m128 mask, __m128 a, __m128 b){
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/**
+ * Four lanes of atan2Fast
+ */
+static inline __m128 atan2Sse(__m128 y, __m128 x){
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 ax = _mm_andnot_ps(sign, x);
+    const __m128 ay = _mm_andnot_ps(sign, y);
+    const __m128 hi = _mm_max_ps(ax, ay);
+    const __m128 lo = _mm_min_ps(ax, ay);
+    const __m128 t = _mm_div_ps(lo, _mm_max_ps(hi, _mm_set1_ps(FLT_MIN)));
+    const __m128 t2 = _mm_mul_ps(t, t);
+
+    __m128 r = _mm_set1_ps(ATAN_C9);
+    r = _mm_add_ps(_mm_mul_ps(r, t2), _mm_set1_ps(ATAN_C7));
+    r = _mm_add_ps(_mm_mul_ps(r, t2), _mm_set1_ps(ATAN_C5));
+    r = _mm_add_ps(_mm_mul_ps(r, t2), _mm_set1_ps(ATAN_C3));
+    r = _mm_add_ps(_mm_mul_ps(r, t2), _mm_set1_ps(ATAN_C1));
+    r = _mm_mul_ps(r, t);
+
+    r = select(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(HALF_PI), r), r);
+    r = select(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(PI), r), r);
+    return _mm_xor_ps(r, _mm_and_ps(y, sign));
+}
+#endif
+
+/**
+ * Inverse kinematics of many poses, both elbow solutions
+ *
+ * Same equations as SCARA::calculateJointAngles. Four poses are solved at once
+ * with SSE2 where available, the rest and other targets use solveScalar.
+ *
+ * @param a1 Length of the first arm
+ * @param a2 Length of the second arm
+ * @param x X coordinates
+ * @param y Y coordinates
+ * @param angle Object angles in degrees
+ * @param n Number of poses
+ * @param out Results, resized to n
+ */
+void solve(float a1, float a2, const float* x, const float* y, const float* angle, size_t n, Batch& out){
+    out.resize(n);
+    size_t i = 0;
+
+#ifdef IK_SSE
+    const __m128 k0 = _mm_set1_ps(a1 * a1 + a2 * a2);
+    const __m128 inv = _mm_set1_ps(1.0f / (2 * a1 * a2));
+    const __m128 va1 = _mm_set1_ps(a1);
+    const __m128 va2 = _mm_set1_ps(a2);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 degrees = _mm_set1_ps(DEGREES);
+
+    for (; i + 4 <= n; i += 4){
+        const __m128 vx = _mm_loadu_ps(x + i);
+        const __m128 vy = _mm_loadu_ps(y + i);
+        const __m128 va = _mm_loadu_ps(angle + i);
+
+        const __m128 r2 = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy));
+        const __m128 c2 = _mm_mul_ps(_mm_sub_ps(r2, k0), inv);
+        const __m128 ok = _mm_and_ps(_mm_cmple_ps(c2, one), _mm_cmpge_ps(c2, _mm_sub_ps(_mm_setzero_ps(), one)));
+
+        const __m128 s2 = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(c2, c2)), _mm_setzero_ps()));
+        const __m128 j2 = atan2Sse(s2, c2);
+        const __m128 base = atan2Sse(vy, vx);
+        const __m128 offset = atan2Sse(_mm_mul_ps(va2, s2), _mm_add_ps(va1, _mm_mul_ps(va2, c2)));
+
+        const __m128 j1r = _mm_and_ps(ok, _mm_mul_ps(_mm_sub_ps(base, offset), degrees));
+        const __m128 j2r = _mm_and_ps(ok, _mm_mul_ps(j2, degrees));
+        const __m128 j1l = _mm_and_ps(ok, _mm_mul_ps(_mm_add_ps(base, offset), degrees));
+        const __m128 j2l = _mm_and_ps(ok, _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), j2), degrees));
+
+        _mm_storeu_ps(&out.j1Right[i], j1r);
+        _mm_storeu_ps(&out.j2Right[i], j2r);
+        _mm_storeu_ps(&out.gripperRight[i], _mm_and_ps(ok, _mm_sub_ps(_mm_add_ps(j1r, j2r), va)));
+        _mm_storeu_ps(&out.j1Left[i], j1l);
+        _mm_storeu_ps(&out.j2Left[i], j2l);
+        _mm_storeu_ps(&out.gripperLeft[i], _mm_and_ps(ok, _mm_sub_ps(_mm_add_ps(j1l, j2l), va)));
+
+        const int mask = _mm_movemask_ps(ok);
+        for (int lane = 0; lane < 4; lane++) out.reachable[i + lane] = (mask >> lane) & 1;
+    }
+#endif
+
+    solveScalar(a1, a2, x, y, angle, i, n, out);
+}
+
+} // namespace ik
@@ -0,0 +1,41 @@
+// ik.h
+#ifndef IK_H
+#define IK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ik {
+
+/**
+ * @brief Joint angles of many poses as structure of arrays, angles in degrees
+ *
+ * Left is the elbow left (negative J2) solution used by SCARA::calculateJointAngles
+ * with elbowLeft set, right the other one. Poses out of reach have reachable
+ * cleared and all angles set to 0. Close to the edge of the workspace the float
+ * rounding of cos(J2) dominates the error of the angles.
+ */
+struct Batch {
+    std::vector<float> j1Left;
+    std::vector<float> j2Left;
+    std::vector<float> gripperLeft;
+    std::vector<float> j1Right;
+    std::vector<float> j2Right;
+    std::vector<float> gripperRight;
+    std::vector<uint8_t> reachable;
+
+    void resize(size_t n);
+    size_t size() const;
+};
+
+constexpr float ATAN_ERROR = 1.2e-5f; // Bound of atan2Fast in radians, 1e-5 of the polynomial plus float rounding
+
+float atan2Fast(float y, float x);
+
+void solve(float a1, float a2, const float* x, const float* y, const float* angle, size_t n, Batch& out);
+void solveScalar(float a1, float a2, const float* x, const float* y, const float* angle, size_t first, size_t n, Batch& out);
+
+} // namespace ik
+
+#endif // IK_H
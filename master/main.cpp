@@ -1,15 +1,31 @@
 #include "master.h" 
 #include "slave.h"
 #include "scara.h"
-#include "camera.h"
+#include "cameraclient.h"
+#include "pickengine.h"
+#include "poseestimator.h"
+#include <atomic>
+#include <csignal>
+#include <fstream>
+
+const bool HARDWARE_TRIGGER = false; // Trigger the camera with a drive output instead of the TCP command
+const uint32_t CAMERA_TRIGGER_OUTPUT = 1 << 17; // Output 2 of the air pressure slave, enabled in its 0x60FE:02 mask
+const char* CAMERA_RECORDING = nullptr; // File for the results to replay with camerasim --replay, replaced on start
+
+std::atomic<bool> stopRequested{false}; // Set on Ctrl+C, lock-free so the handler may write it
+
+void requestStop(int){
+    stopRequested = true;
+}
 
 int main(int argc, char* argv[]){
     int numSlaves = 4;    
     char ifaceName[] = "\\Device\\NPF_{DEA85026-34BA-4C8B-9840-A3CE7793A348}";
     Master ecMaster(ifaceName, 8000);
-    Camera client("192.168.0.101", 2006); // send message to camera
-    Camera client2("192.168.0.101", 2005); // receive message from camera
-    if (ecMaster.connected()){
+    CameraRecorder recorder; // Before the camera, its event loop records until it stops
+    CameraClient camera("192.168.0.101", 2006, 2005); // Trigger on 2006, results on 2005
+    if (CAMERA_RECORDING && recorder.open(CAMERA_RECORDING) == EXIT_SUCCESS) camera.setRecorder(&recorder);
+    if (ecMaster.connected() && camera.start() == EXIT_SUCCESS){
        std::vector <Slave> ecSlaves;
         
         for(int i = 1; i <= numSlaves; i++) {
@@ -17,24 +33,33 @@ int main(int argc, char* argv[]){
         }
 
         SCARA scaraRobot(250, 280, ecSlaves, 3);
+        if (scaraRobot.checkScaling() != EXIT_SUCCESS) return EXIT_FAILURE; // Targets would be off by a factor
+        scaraRobot.loadWorkspace("workspace.grid");
+        PoseEstimator pose(ecMaster, scaraRobot);
+        scaraRobot.setPoseEstimator(&pose);
 
-        while(true){
-            client.capture();
+        // Capture the next battery while the previous one is delivered
+        HardwareTrigger cameraTrigger(ecMaster, 3, CAMERA_TRIGGER_OUTPUT);
+        PickEngine engine(scaraRobot, camera, &ecMaster, HARDWARE_TRIGGER ? &cameraTrigger : nullptr);
 
-            // Save the data from the camera in a vector
-            std::vector<double> coordinates = client2.receiveMessage();
+        // Stop after the current pick on Ctrl+C or when the bus is lost, so the statistics below are written
+        std::signal(SIGINT, requestStop);
+        std::signal(SIGTERM, requestStop);
+        std::thread watcher([&]() {
+            while (!stopRequested && ecMaster.connected()) std::this_thread::sleep_for(std::chrono::milliseconds(EC_PROGRESSINTERVAL));
+            engine.stop();
+        });
+        engine.run();
+        stopRequested = true;
+        watcher.join();
 
-            double x = coordinates[0];
-            double y = coordinates[1];
-            double angle = coordinates[2];
-
-            // Pick up the battery from the coordinates given by the camera
-            scaraRobot.pickUp(x, y, angle, false);
-
-            // Deliver the battery to destination
-            scaraRobot.drop(false);
-        }
-            
+        // Where the cycle time goes, the trace opens in chrome://tracing or Perfetto
+        std::ofstream summary("phases.csv");
+        scaraRobot.getTracer().dumpSummary(summary);
+        std::ofstream trace("trace.json");
+        scaraRobot.getTracer().dumpChromeTrace(trace);
+        std::ofstream latency("camera.csv");
+        engine.getCameraLatency().dumpSummary(latency);
     
         return EXIT_SUCCESS;
     }
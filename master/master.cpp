@@ -1,6 +1,10 @@
 // master.cpp : Source file for your target.
 
 #include "master.h"
+#include <algorithm>
+#include <cmath>
+
+Master* Master::active = nullptr;
 
 /**
  * Constructor for the EtherCat Master
@@ -9,7 +13,7 @@
  * @param cycletime Cycle time in microseconds
  * @param showNonErrors Show non errors
  */
-Master::Master(char ifname[], const uint32_t cycletime, bool showNonErrors){
+Master::Master(char ifname[], const uint32_t cycletime, bool showNonErrors) : scheduler(cycletime), dcsync(cycletime, EC_DCSENDOFFSET){
     /* init values */
     this->inOP = FALSE;
     this->ctime = cycletime;
@@ -26,6 +30,8 @@ Master::Master(char ifname[], const uint32_t cycletime, bool showNonErrors){
 
         if (inOP){
             cycle_thread = std::thread(&Master::cycle, this);
+            supervising = true;
+            supervisor_thread = std::thread(&Master::supervise, this);
         }
         else{
             printf("Unable to start EtherCat Master");
@@ -47,12 +53,19 @@ Master::~Master(){
             puts("Shutting down Ethercat");
             printf("\nRequest init state for all slaves\n");
         }
+        // Stop recovery first, it would bring the slaves back to OP
+        supervising = false;
+        supervisor_thread.join();
         ec_slave[0].state = EC_STATE_INIT; // 0 = master
         /* request INIT state for all slaves */
         ec_writestate(0); // 0 = master
         for (int timeout= this->ctime; timeout && ec_readstate() != EC_STATE_INIT;timeout--) waitCycle();
         inOP = FALSE;
         cycle_thread.join();
+        // Release threads still waiting on a statusword, the cycle thread is gone so the lock may be waited for
+        { std::lock_guard<std::mutex> lock(statusMutex); }
+        statusChanged.notify_all();
+        abortAxes();
         if (verbose && ec_readstate() == EC_STATE_INIT)puts("Clean Exit");
         else puts("Could not exit cleanly");
         if (verbose) puts("Closing connection");
@@ -76,6 +89,28 @@ bool Master::readyState(int slaveNr){
     return retVal; 
 }
 
+/**
+ * Byte offset of the outputs of a slave in the IOmap
+ * 
+ * @param slaveNr Slave number
+ * 
+ * @return Offset in bytes
+ */
+uint32_t Master::outputOffset(int slaveNr){
+    return (uint32_t)(ec_slave[slaveNr].outputs - (uint8*)IOmap);
+}
+
+/**
+ * Byte offset of the inputs of a slave in the IOmap
+ * 
+ * @param slaveNr Slave number
+ * 
+ * @return Offset in bytes
+ */
+uint32_t Master::inputOffset(int slaveNr){
+    return (uint32_t)(ec_slave[slaveNr].inputs - (uint8*)IOmap);
+}
+
 /**
  * Set a bit
  * 
@@ -92,10 +127,7 @@ uint8_t Master::setBit(int slaveNr, uint8_t bit, uint8_t byte){
         if (byte >= ec_slave[slaveNr].Obytes) byte = 0; // prevent out of bounds
     }
     
-    uint8_t base = *(ec_slave[slaveNr].outputs + byte);
-    base |= (1 << bit);
-    this->setByte(slaveNr, base, byte);
-    return base;
+    return image.modify(outputOffset(slaveNr) + byte, (1 << bit), 0);
 }
 
 /**
@@ -114,10 +146,7 @@ uint8_t Master::unsetBit(int slaveNr, uint8_t bit, uint8_t byte){
         if (byte >= ec_slave[slaveNr].Obytes) byte = 0; // prevent out of bounds
     }
     
-    uint8_t base = *(ec_slave[slaveNr].outputs + byte);
-    base &= ~(1 << bit);
-    this->setByte(slaveNr, base, byte);
-    return base;
+    return image.modify(outputOffset(slaveNr) + byte, 0, (1 << bit));
 }
 
 /**
@@ -141,6 +170,17 @@ uint16_t Master::unsetControl(int slaveNr){
     return retVal;
 }
 
+/**
+ * Set and clear controlword bits from the cycle thread
+ * 
+ * @param slaveNr Slave number
+ * @param set Bits to set
+ * @param clear Bits to clear
+ */
+void Master::cycleControl(int slaveNr, uint16_t set, uint16_t clear){
+    image.overlayBits<uint16_t>(outputOffset(slaveNr) + Controlword, set, clear);
+}
+
 /**
  * Get the value of a bit
  * 
@@ -157,10 +197,22 @@ bool Master::getBit(int slaveNr, uint8_t bit, uint8_t byte){
         if (byte >= ec_slave[slaveNr].Ibytes) byte = 0; // Prevent out of bounds
     }
 
-    const auto retVal = *(ec_slave[slaveNr].inputs + byte) & (1 << bit);
+    const auto retVal = getByte(slaveNr, byte) & (1 << bit);
     return retVal;
 }
 
+/**
+ * Get a byte from the inputs of the last cycle
+ * 
+ * @param slaveNr Slave number
+ * @param byte Byte to read
+ * 
+ * @return Byte value
+ */
+uint8_t Master::getByte(int slaveNr, uint8_t byte){
+    return image.readByte(inputOffset(slaveNr) + byte);
+}
+
 /**
  * Sets a byte
  * 
@@ -169,9 +221,7 @@ bool Master::getBit(int slaveNr, uint8_t bit, uint8_t byte){
  * @param byte Byte to start writing
  */
 void Master::setByte(int slaveNr, uint8_t value, uint8_t byte){
-    m.lock();
-    *(ec_slave[slaveNr].outputs + byte) = value;
-    m.unlock();
+    image.write(outputOffset(slaveNr) + byte, &value, sizeof(value));
 }
 
 /**
@@ -198,9 +248,11 @@ int Master::getError(int slaveNr){
  */
 int16_t Master::get16(int slaveNr, uint8_t byte){
     auto retVal = 0;
+    uint8_t data[2];
+    image.read(inputOffset(slaveNr) + byte, data, sizeof(data));
     
-    retVal += (*(ec_slave[slaveNr].inputs + byte + 1) << 8);
-    retVal += (*(ec_slave[slaveNr].inputs + byte + 0));
+    retVal += (data[1] << 8);
+    retVal += (data[0]);
 
     return retVal;
 }
@@ -213,15 +265,7 @@ int16_t Master::get16(int slaveNr, uint8_t byte){
  * @return Position
  */
 int32_t Master::getPos(int slaveNr){
-    auto retVal = 0;
-    const int positionActualValueAddress = 3;
-       
-    retVal += (*(ec_slave[slaveNr].inputs + positionActualValueAddress + 3) << 24);
-    retVal += (*(ec_slave[slaveNr].inputs + positionActualValueAddress + 2) << 16);
-    retVal += (*(ec_slave[slaveNr].inputs + positionActualValueAddress + 1) << 8);
-    retVal += (*(ec_slave[slaveNr].inputs + positionActualValueAddress + 0));
-
-    return retVal;
+    return get<pdo::Position_Actual_Value>(slaveNr);
 }
 
 /**
@@ -249,10 +293,10 @@ bool Master::connected(){
  * Set a value of 16 bits
  */
 void Master::set16(int slaveNr, int16_t value, uint8_t byte){
-    m.lock();
-    *(ec_slave[slaveNr].outputs + byte + 1) = (value >> 8) & 0xFF;
-    *(ec_slave[slaveNr].outputs + byte + 0) = value & 0xFF;
-    m.unlock();
+    uint8_t data[2];
+    data[1] = (value >> 8) & 0xFF;
+    data[0] = value & 0xFF;
+    image.write(outputOffset(slaveNr) + byte, data, sizeof(data));
 }
 
 /**
@@ -260,30 +304,19 @@ void Master::set16(int slaveNr, int16_t value, uint8_t byte){
  * 
  * @param slaveNr Slave number
  * @param target Target position
- * @param byte Byte to start writing
  */
-void Master::setPos(int slaveNr, int32_t target, uint8_t byte ){
-    m.lock();
-    *(ec_slave[slaveNr].outputs + byte + 3) = (target >> 24) & 0xFF;
-    *(ec_slave[slaveNr].outputs + byte + 2) = (target >> 16) & 0xFF;
-    *(ec_slave[slaveNr].outputs + byte + 1) = (target >>  8) & 0xFF;
-    *(ec_slave[slaveNr].outputs + byte + 0) = target & 0xFF;
-    m.unlock();
+void Master::setPos(int slaveNr, int32_t target){
+    set<pdo::Target_Position>(slaveNr, target);
 }
 
 /**
  * @brief Set velocity target
  * 
- * @param slaveNr 
- * @param velocity 
+ * @param slaveNr Slave number
+ * @param velocity Target velocity
  */
-void Master::setTargetVelocity(int slaveNr, uint32_t velocity, uint8_t byte){
-    m.lock();
-    *(ec_slave[slaveNr].outputs + byte + 3) = (velocity >> 24) & 0xFF;
-    *(ec_slave[slaveNr].outputs + byte + 2) = (velocity >> 16) & 0xFF;
-    *(ec_slave[slaveNr].outputs + byte + 1) = (velocity >> 8) & 0xFF;
-    *(ec_slave[slaveNr].outputs + byte + 0) = velocity & 0xFF;
-    m.unlock();
+void Master::setTargetVelocity(int slaveNr, int32_t velocity){
+    set<pdo::Target_Velocity>(slaveNr, velocity);
 }
 
 /**
@@ -291,15 +324,9 @@ void Master::setTargetVelocity(int slaveNr, uint32_t velocity, uint8_t byte){
  * 
  * @param slaveNr Slave number
  * @param velocity Velocity
- * @param byte Byte to start writing
  */
-void Master::setProfileVelocity(int slaveNr, uint32_t velocity, uint8_t byte){
-    m.lock();
-    *(ec_slave[slaveNr].outputs + byte + 3) = (velocity >> 24) & 0xFF;
-    *(ec_slave[slaveNr].outputs + byte + 2) = (velocity >> 16) & 0xFF;
-    *(ec_slave[slaveNr].outputs + byte + 1) = (velocity >> 8) & 0xFF;
-    *(ec_slave[slaveNr].outputs + byte + 0) = velocity & 0xFF;
-    m.unlock();
+void Master::setProfileVelocity(int slaveNr, uint32_t velocity){
+    set<pdo::Profile_Velocity>(slaveNr, velocity);
 }
 
 /**
@@ -326,9 +353,7 @@ int Master::reset(int slaveNr){
     unsigned int timeout = 1000;
     if(verbose)printf("Resetting slave nr : %d\n",slaveNr);
     if (this->inOP){
-        m.lock();
-        memset(ec_slave[slaveNr].outputs, 0, ec_slave[slaveNr].Obytes); // Start empty to prevent retriggering error
-        m.unlock();
+        image.clear(outputOffset(slaveNr), ec_slave[slaveNr].Obytes); // Start empty to prevent retriggering error
         if (verbose)printf("Wait for empty frame slave nr : %d\n", slaveNr);
         waitCycle(); // Wait for empty frame to be send
 
@@ -505,7 +530,7 @@ int Master::referencing_task(int slaveNr, bool always){
             printf("Slave %d starting homing\n", slaveNr);
             unsetControl(slaveNr);
             setBit(slaveNr, control_4);
-            while (!getBit(slaveNr, status_ref_reached)); // Check for rehoming
+            wait_bits(slaveNr, 1 << status_ref_reached, 1 << status_ref_reached); // Check for rehoming
             unsetBit(slaveNr, control_4);
         }
         return 0;
@@ -546,7 +571,7 @@ void Master::jog_task(int slaveNr, bool jog_positive, bool jog_negative, float d
 
         uint8_t controlbyte = setMode(slaveNr, jog_mode);
         unsetControl(slaveNr);
-        while (!getBit(slaveNr, status_mc));
+        wait_bits(slaveNr, 1 << status_mc, 1 << status_mc);
         controlbyte = setBit(slaveNr, controlBit);
         if (duration > 0) {
             std::this_thread::sleep_for(std::chrono::milliseconds((int) (duration * 1000)));
@@ -566,7 +591,7 @@ void Master::stop_motion_task(int slaveNr){
     if (verbose)printf("Stopping Movement\n");
     if (readyState(slaveNr)){
         unsetControl(slaveNr);
-        while (!getBit(slaveNr, status_mc)) waitCycle();
+        wait_bits(slaveNr, 1 << status_mc, 1 << status_mc);
     }
 }
 
@@ -598,11 +623,11 @@ int Master::position_task(int slaveNr, int32_t target, bool absolute, bool nonbl
      */
     char modeVar[9] = "Relative";
     //Copy mode in to the global variable
-    strncpy_s(mode, modeVar, 9);
+    strncpy(mode, modeVar, sizeof(mode));
     //Copy target in to the global variable
     this->target = target;
     if (absolute){
-        strncpy_s(mode, "Absolute", 9);
+        strncpy(mode, "Absolute", sizeof(mode));
     }
     if (verbose)printf("Starting %s movement to position %d of slave % d\n",mode , target, slaveNr);
     if (readyState(slaveNr)){
@@ -617,10 +642,10 @@ int Master::position_task(int slaveNr, int32_t target, bool absolute, bool nonbl
             if (verbose) printf("Non-blocking mode: Movement initiated\n");
             return EXIT_SUCCESS;
         }
-        while (!getBit(slaveNr, status_ack_start)); // Wait for ack to prevent response to previous mc 
-        while (!getBit(slaveNr, status_mc)){
+        wait_bits(slaveNr, 1 << status_ack_start, 1 << status_ack_start); // Wait for ack to prevent response to previous mc 
+        unsetControl(slaveNr);
+        while (!wait_bits(slaveNr, 1 << status_mc, 1 << status_mc, EC_PROGRESSINTERVAL) && inOP){
             if (verbose)printf("Move slave %d %s : %d %d\r", slaveNr, mode, target, getPos(slaveNr));
-            unsetControl(slaveNr);
         }
         if (verbose)printf("\n");
         if (verbose)printf(" completed\n");
@@ -710,12 +735,12 @@ int Master::position_task(int slaveNr, int32_t target, uint32_t velocity, uint32
  * @return TRUE if target position is reached
  */
 bool Master::wait_for_target_position(int slaveNr) {
-    while (!getBit(slaveNr, status_ack_start)); // Wait for ack to prevent response to previous motion command
-    while (!getBit(slaveNr, status_mc)) {
+    wait_bits(slaveNr, 1 << status_ack_start, 1 << status_ack_start); // Wait for ack to prevent response to previous motion command
+    unsetControl(slaveNr);
+    while (!wait_bits(slaveNr, 1 << status_mc, 1 << status_mc, EC_PROGRESSINTERVAL) && inOP) {
         if (verbose) {
             printf("Move slave %d %s : %d %d\r", slaveNr, mode, target, getPos(slaveNr));
         }
-        unsetControl(slaveNr);
     }
     if (verbose)printf("\n");
     return TRUE;
@@ -727,27 +752,636 @@ bool Master::wait_for_target_position(int slaveNr) {
  * orchestrates the communication cycle with EtherCAT slaves,
  * ensuring that data is sent and received within the specified
  * cycle time.
+ * 
+ * @note The cycle sleeps until absolute deadlines, so a late wake-up
+ *       does not shift the phase of the following cycles
+ * @note Outputs staged by the application are published right before sending and
+ *       inputs are captured right after receiving, no lock is held during the exchange
  */
 void Master::cycle(){
-    auto cycletime = std::chrono::microseconds(this->ctime);
+    uint8* iomap = (uint8*)IOmap;
+    const uint32_t outputs = outputOffset(0);
+    const uint32_t inputs = inputOffset(0);
+    scheduler.start();
 
     while (this->inOP) {
-        auto start = std::chrono::high_resolution_clock::now();
-        m.lock();
+        image.publish(iomap, outputs, ec_slave[0].Obytes);
+        const int64_t sendStart = CycleScheduler::now();
         ec_send_processdata();
+        const int64_t sent = CycleScheduler::now();
         wkc = ec_receive_processdata(EC_TIMEOUTRET);
-        m.unlock();
-        auto end = std::chrono::high_resolution_clock::now();
-        const auto delta = end - start;
-        if (delta > cycletime){
-            std::cout << "System too slow for cycle time " << cycletime.count() << "ms sending takes " << delta.count() << "ns" << std::endl;
+        const int64_t received = CycleScheduler::now();
+        cycleSeq.writeBegin();
+        lastCycle.cycle++;
+        lastCycle.sent = sendStart;
+        lastCycle.dcTime = ec_DCtime;
+        cycleSeq.writeEnd();
+        image.capture(iomap, inputs, ec_slave[0].Ibytes);
+        notifyStatus();
+        stepAxes();
+        runHooks();
+
+        if (dcActive.load(std::memory_order_relaxed)){
+            if (dcRestart.exchange(false)) dcsync.reset();
+            // Move the next deadline so the frame keeps its distance to SYNC0
+            scheduler.shift(dcsync.update(ec_DCtime));
+            metrics.dcOffset.record(std::abs(dcsync.getOffset()));
+            metrics.dcOffsetNs.store(dcsync.getOffset(), std::memory_order_relaxed);
+            metrics.dcDriftNs.store(dcsync.getDrift(), std::memory_order_relaxed);
         }
-        else{
-            std::this_thread::sleep_for(cycletime - delta);
+
+        metrics.send.record(sent - sendStart);
+        metrics.roundtrip.record(received - sendStart);
+        metrics.lastWKC.store(wkc, std::memory_order_relaxed);
+        if (wkc != metrics.expectedWKC.load(std::memory_order_relaxed)) metrics.wkcMismatches.fetch_add(1, std::memory_order_relaxed);
+        metrics.cycles.fetch_add(1, std::memory_order_relaxed);
+
+        // No output from here, overruns are counted and can be read with getMetrics
+        if (!scheduler.waitNext()) metrics.overruns.fetch_add(1, std::memory_order_relaxed);
+        metrics.wakeupJitter.record(CycleScheduler::now() - scheduler.deadline());
+    }
+}
+
+/**
+ * Register a function that is called by the cycle thread every cycle
+ * 
+ * The hook runs after the inputs are captured and before the next deadline, it
+ * has to return quickly and must not wait for the cycle thread. Outputs are
+ * set with @see cycleOutputs, the application side setters may wait.
+ * 
+ * @param hook Function to call
+ * 
+ * @return Id to remove the hook with
+ */
+int Master::addCycleHook(std::function<void()> hook){
+    std::lock_guard<std::mutex> lock(hookMutex);
+    hooks.emplace_back(nextHook, std::move(hook));
+    return nextHook++;
+}
+
+/**
+ * Remove a cycle hook
+ * 
+ * @param id Id returned by @see addCycleHook
+ * 
+ * @note The hook is not running anymore when this returns
+ */
+void Master::removeCycleHook(int id){
+    std::lock_guard<std::mutex> lock(hookMutex);
+    for (auto it = hooks.begin(); it != hooks.end(); ++it){
+        if (it->first == id){
+            hooks.erase(it);
+            return;
+        }
+    }
+}
+
+/**
+ * Call the registered cycle hooks
+ * 
+ * @note Skipped for one cycle while hooks are added or removed
+ */
+void Master::runHooks(){
+    std::unique_lock<std::mutex> lock(hookMutex, std::try_to_lock);
+    if (!lock.owns_lock()) return;
+    for (auto& hook : hooks) hook.second();
+}
+
+/**
+ * Notify status waiters if any statusword or digital input changed in the last cycle
+ * 
+ * @note Called by the cycle thread right after the inputs are captured, never waits for a waiter
+ */
+void Master::notifyStatus(){
+    bool changed = false;
+    for (int i = 1; i <= ec_slavecount && i < EC_MAXSLAVE; i++){
+        const uint16_t status = get<pdo::Statusword>(i);
+        if (status != lastStatus[i]){
+            lastStatus[i] = status;
+            changed = true;
+        }
+        const uint32_t inputs = get<pdo::Digital_Input_States>(i);
+        if (inputs != lastInputs[i]){
+            lastInputs[i] = inputs;
+            changed = true;
+        }
+    }
+    if (changed) notifyPending = true;
+    if (notifyPending){
+        // Only tried, a waiter holds the mutex while it checks, notified next cycle then
+        std::unique_lock<std::mutex> lock(statusMutex, std::try_to_lock);
+        if (!lock.owns_lock()) return;
+        lock.unlock(); // Taken once so the notify comes after a waiter's check
+        notifyPending = false;
+        statusChanged.notify_all();
+    }
+}
+
+/**
+ * Queue a profile position move without blocking
+ * 
+ * The move is executed by a per drive state machine inside the cycle thread:
+ * select profile position mode, stage target and velocity, set the start bit,
+ * wait for the acknowledge and then for motion complete. Commands for the same
+ * drive run one after the other, commands for different drives in parallel.
+ * 
+ * @param command Move to execute
+ * 
+ * @return Future that becomes EXIT_SUCCESS when the target is reached or EXIT_FAILURE
+ */
+std::future<int> Master::submit(const MotionCommand& command){
+    std::promise<int> done;
+    std::future<int> result = done.get_future();
+    if (!this->inOP || command.slaveNr < 1 || command.slaveNr > ec_slavecount || command.slaveNr >= EC_MAXSLAVE){
+        printf("Drive %d not available, movement not possible\n", command.slaveNr);
+        done.set_value(EXIT_FAILURE);
+        return result;
+    }
+    Axis& axis = axes[command.slaveNr];
+    std::lock_guard<std::mutex> lock(axis.lock);
+    axis.queue.emplace_back(command, std::move(done));
+    return result;
+}
+
+/**
+ * Advance the motion command state machines of all drives by one cycle
+ * 
+ * @note Called by the cycle thread after the inputs are captured, the outputs
+ *       written here go out with the next frame
+ */
+void Master::stepAxes(){
+    for (int i = 1; i <= ec_slavecount && i < EC_MAXSLAVE; i++){
+        stepAxis(i, axes[i]);
+    }
+}
+
+/**
+ * Advance the motion command state machine of one drive
+ * 
+ * @param slaveNr Slave number
+ * @param axis State of the drive
+ */
+void Master::stepAxis(int slaveNr, Axis& axis){
+    const uint16_t status = get<pdo::Statusword>(slaveNr);
+    axis.ticks++;
+
+    if (axis.state != Axis::idle && (status & (1 << status_fault))){
+        axis.done.set_value(EXIT_FAILURE);
+        axis.state = Axis::idle;
+    }
+
+    // Streaming has priority, queued moves start after csp_stop
+    if (axis.csp.load(std::memory_order_acquire)){
+        stepCsp(slaveNr, axis);
+        return;
+    }
+
+    switch (axis.state){
+        case Axis::idle:
+            // Never wait for an application thread, pick the command up next cycle
+            if (axis.lock.try_lock()){
+                if (!axis.queue.empty()){
+                    axis.command = axis.queue.front().first;
+                    axis.done = std::move(axis.queue.front().second);
+                    axis.queue.pop_front();
+                    axis.state = Axis::mode;
+                    axis.ticks = 0;
+                }
+                axis.lock.unlock();
+            }
+            break;
+
+        case Axis::mode:
+            if (!(status & (1 << status_operation_enabled))){
+                axis.done.set_value(EXIT_FAILURE);
+                axis.state = Axis::idle;
+            }
+            else if (get<pdo::Mode_of_Operation_Display>(slaveNr) == profile_position_mode){
+                const uint16_t relative = axis.command.absolute ? 0 : (1 << control_6);
+                cycleControl(slaveNr, relative, (control_mode_bits & ~relative) | (1 << control_halt));
+                cycleSet<pdo::Target_Position>(slaveNr, axis.command.target);
+                if (axis.command.velocity > 0) cycleSet<pdo::Profile_Velocity>(slaveNr, axis.command.velocity);
+                if (axis.command.velocity > 0) axis.velocity = axis.command.velocity;
+
+                // Twice the time at profile velocity covers the ramps, without a known velocity only the margin
+                const int64_t start = axis.command.absolute ? get<pdo::Position_Actual_Value>(slaveNr) : 0;
+                const double distance = std::fabs((double)axis.command.target - (double)start);
+                const double planned = axis.velocity > 0 ? 2000.0 * distance / axis.velocity : 0.0;
+                axis.limit = (uint32_t)std::min((planned + EC_MOVEMARGIN) * 1000.0 / ctime, (double)UINT32_MAX);
+                axis.state = Axis::arm;
+                axis.ticks = 0;
+            }
+            else if (axis.ticks > 100){ // Same number of cycles as setMode
+                axis.done.set_value(EXIT_FAILURE);
+                axis.state = Axis::idle;
+            }
+            else{
+                cycleControl(slaveNr, 0, control_mode_bits);
+                cycleSet<pdo::Mode_of_Operation>(slaveNr, profile_position_mode);
+            }
+            break;
+
+        case Axis::arm:
+            // Target and velocity went out last cycle, now start the motion
+            cycleControl(slaveNr, 1 << control_4, 0);
+            axis.state = Axis::ack;
+            axis.ticks = 0;
+            break;
+
+        case Axis::ack:
+            // Wait for ack to prevent response to previous mc
+            if (status & (1 << status_ack_start)){
+                cycleControl(slaveNr, 0, control_mode_bits);
+                axis.state = Axis::moving;
+                axis.ticks = 0;
+            }
+            else if (axis.ticks > EC_ACKTIMEOUT * 1000 / ctime){ // E.g. a target outside the software limits
+                cycleControl(slaveNr, 0, control_mode_bits);
+                axis.done.set_value(EXIT_FAILURE);
+                axis.state = Axis::idle;
+            }
+            break;
+
+        case Axis::moving:
+            if (status & (1 << status_mc)){
+                axis.done.set_value(EXIT_SUCCESS);
+                axis.state = Axis::idle;
+            }
+            else if (axis.ticks > axis.limit){
+                // Stop the drive so it is not moving when the caller sees the failure
+                cycleControl(slaveNr, 1 << control_halt, control_mode_bits);
+                axis.done.set_value(EXIT_FAILURE);
+                axis.state = Axis::idle;
+            }
+            break;
+    }
+}
+
+/**
+ * Write the next interpolated setpoint of a drive in cyclic synchronous position mode
+ * 
+ * Takes the next segment from the ring when the current one is finished and
+ * interpolates linearly over its number of cycles. Without new setpoints the
+ * drive holds the last one.
+ * 
+ * @param slaveNr Slave number
+ * @param axis State of the drive
+ */
+void Master::stepCsp(int slaveNr, Axis& axis){
+    if (axis.segmentLeft == 0){
+        CspSetpoint next;
+        if (axis.setpoints->pop(next)){
+            axis.segmentStart = axis.setpoint;
+            axis.segmentTarget = next.position;
+            axis.segmentCycles = next.cycles > 0 ? next.cycles : 1;
+            axis.segmentLeft = axis.segmentCycles;
+        }
+    }
+    if (axis.segmentLeft > 0){
+        axis.segmentLeft--;
+        const int64_t step = axis.segmentCycles - axis.segmentLeft;
+        axis.setpoint = (int32_t)(axis.segmentStart + (axis.segmentTarget - axis.segmentStart) * step / axis.segmentCycles);
+        cycleSet<pdo::Target_Position>(slaveNr, axis.setpoint);
+        if (axis.segmentLeft == 0) axis.completed.fetch_add(1, std::memory_order_release);
+    }
+}
+
+/**
+ * Switch a drive to cyclic synchronous position mode
+ * 
+ * From here on the cycle thread writes a new target position every cycle, taken
+ * from the setpoints passed to @see csp_push. The drive starts holding its
+ * current position.
+ * 
+ * @param slaveNr Slave number
+ * 
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ * @note Use DC synchronisation (@see enableDcSync) to avoid following errors from jitter
+ */
+int Master::csp_start(int slaveNr){
+    if (slaveNr < 1 || slaveNr > ec_slavecount || slaveNr >= EC_MAXSLAVE || !readyState(slaveNr)){
+        printf("Drive %d not enabled, cyclic synchronous position not possible\n", slaveNr);
+        return EXIT_FAILURE;
+    }
+    Axis& axis = axes[slaveNr];
+    if (axis.csp || axis.state != Axis::idle){
+        printf("Drive %d busy, cyclic synchronous position not possible\n", slaveNr);
+        return EXIT_FAILURE;
+    }
+
+    // The cycle thread does not touch the ring while streaming is off
+    if (!axis.setpoints) axis.setpoints.reset(new SpscRing<CspSetpoint, CSP_BUFFER>());
+    CspSetpoint stale;
+    while (axis.setpoints->pop(stale));
+    axis.segmentLeft = 0;
+    axis.pushed = 0;
+    axis.completed = 0;
+
+    // Hold the current position so switching the mode does not move the drive
+    axis.setpoint = getPos(slaveNr);
+    setPos(slaveNr, axis.setpoint);
+    waitCycle();
+    setMode(slaveNr, cyclic_sync_pos_mode);
+    unsetBit(slaveNr, control_halt);
+    if (get<pdo::Mode_of_Operation_Display>(slaveNr) != cyclic_sync_pos_mode) return EXIT_FAILURE;
+
+    axis.csp.store(true, std::memory_order_release);
+    if (verbose)printf("Drive %d streaming in cyclic synchronous position mode from %d\n", slaveNr, axis.setpoint);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Queue a setpoint for a drive in cyclic synchronous position mode
+ * 
+ * @param slaveNr Slave number
+ * @param setpoint Position and number of cycles to reach it
+ * 
+ * @return false if the buffer is full or streaming is not active
+ * @note Only one thread may push setpoints for a drive
+ */
+bool Master::csp_push(int slaveNr, const CspSetpoint& setpoint){
+    if (slaveNr < 1 || slaveNr >= EC_MAXSLAVE || !axes[slaveNr].csp) return false;
+    Axis& axis = axes[slaveNr];
+    if (!axis.setpoints->push(setpoint)) return false;
+    axis.pushed++;
+    return true;
+}
+
+/**
+ * Get the free space in the setpoint buffer of a drive
+ * 
+ * @param slaveNr Slave number
+ * 
+ * @return Number of setpoints that can be pushed without failing
+ */
+size_t Master::csp_free(int slaveNr){
+    if (slaveNr < 1 || slaveNr >= EC_MAXSLAVE || !axes[slaveNr].csp) return 0;
+    return axes[slaveNr].setpoints->free();
+}
+
+/**
+ * Check if a drive has written all pushed setpoints
+ * 
+ * @param slaveNr Slave number
+ * 
+ * @return true if every pushed segment is finished
+ */
+bool Master::csp_done(int slaveNr){
+    if (slaveNr < 1 || slaveNr >= EC_MAXSLAVE) return true;
+    return axes[slaveNr].completed.load(std::memory_order_acquire) == axes[slaveNr].pushed;
+}
+
+/**
+ * Check if a drive is streaming in cyclic synchronous position mode
+ * 
+ * @param slaveNr Slave number
+ * 
+ * @return true between @see csp_start and @see csp_stop
+ */
+bool Master::csp_active(int slaveNr){
+    if (slaveNr < 1 || slaveNr >= EC_MAXSLAVE) return false;
+    return axes[slaveNr].csp.load(std::memory_order_acquire);
+}
+
+/**
+ * Stop streaming setpoints to a drive
+ * 
+ * The drive holds the last setpoint. Queued profile position moves continue
+ * after this and switch the mode back themselves.
+ * 
+ * @param slaveNr Slave number
+ */
+void Master::csp_stop(int slaveNr){
+    if (slaveNr < 1 || slaveNr >= EC_MAXSLAVE) return;
+    axes[slaveNr].csp.store(false, std::memory_order_release);
+    waitCycle(); // Let the cycle thread leave the streaming step
+}
+
+/**
+ * Fail all queued and active motion commands
+ * 
+ * @note Called after the cycle thread has stopped
+ */
+void Master::abortAxes(){
+    for (int i = 1; i <= ec_slavecount && i < EC_MAXSLAVE; i++){
+        Axis& axis = axes[i];
+        if (axis.state != Axis::idle){
+            axis.done.set_value(EXIT_FAILURE);
+            axis.state = Axis::idle;
         }
+        std::lock_guard<std::mutex> lock(axis.lock);
+        for (auto& queued : axis.queue){
+            queued.second.set_value(EXIT_FAILURE);
+        }
+        axis.queue.clear();
     }
 }
 
+/**
+ * Wait until the masked statusword bits of a slave have a given value
+ * 
+ * @param slaveNr Slave number
+ * @param mask Statusword bits to compare
+ * @param value Expected value of the masked bits
+ * @param timeout Timeout in milliseconds, 0 waits forever
+ * 
+ * @return true if the bits have the value, false on timeout
+ */
+bool Master::wait_bits(int slaveNr, uint16_t mask, uint16_t value, uint32_t timeout){
+    return waitStatus(slaveNr, [mask, value](uint16_t status){ return (status & mask) == value; }, timeout);
+}
+
+/**
+ * Wait until the masked digital inputs of a slave have a given value
+ * 
+ * @param slaveNr Slave number
+ * @param mask Input bits of 0x213D:01 to compare
+ * @param value Expected value of the masked bits
+ * @param timeout Timeout in milliseconds, 0 waits forever
+ * 
+ * @return true if the inputs have the value, false on timeout or when the master stops
+ */
+bool Master::wait_inputs(int slaveNr, uint32_t mask, uint32_t value, uint32_t timeout){
+    auto done = [&]{ return (get<pdo::Digital_Input_States>(slaveNr) & mask) == value || !this->inOP; };
+    std::unique_lock<std::mutex> lock(statusMutex);
+    if (timeout == 0) statusChanged.wait(lock, done);
+    else statusChanged.wait_for(lock, std::chrono::milliseconds(timeout), done);
+    return this->inOP && (get<pdo::Digital_Input_States>(slaveNr) & mask) == value;
+}
+
+/**
+ * Set and clear digital outputs of a slave
+ * 
+ * Only outputs enabled in the bitmask 0x60FE:02 are switched by the drive.
+ * 
+ * @param slaveNr Slave number
+ * @param set Output bits to set
+ * @param clear Output bits to clear
+ * 
+ * @return Staged value of 0x60FE:01
+ */
+uint32_t Master::setOutputs(int slaveNr, uint32_t set, uint32_t clear){
+    return image.modifyBits<uint32_t>(outputOffset(slaveNr) + pdo::RxPdo::offset<pdo::Digital_Outputs>(), set, clear);
+}
+
+/**
+ * Set and clear digital outputs of a slave from a cycle hook
+ * 
+ * Goes through the overlay of the process image like the outputs of the
+ * motion state machines, so a hook never waits for an application thread.
+ * 
+ * @param slaveNr Slave number
+ * @param set Output bits to set
+ * @param clear Output bits to clear
+ * 
+ * @note Only call from the cycle thread, @see addCycleHook
+ */
+void Master::cycleOutputs(int slaveNr, uint32_t set, uint32_t clear){
+    image.overlayBits<uint32_t>(outputOffset(slaveNr) + pdo::RxPdo::offset<pdo::Digital_Outputs>(), set, clear);
+}
+
+/**
+ * Run the cycle thread with real-time priority
+ * 
+ * @param priority SCHED_FIFO priority (1-99), 0 keeps the default scheduling
+ * @param cpu CPU to pin the cycle thread to, -1 to allow all CPUs
+ * 
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ * @see makeRealtime from CycleScheduler
+ */
+int Master::setRealtime(int priority, int cpu){
+    if (!cycle_thread.joinable()){
+        printf("Cycle thread not running, real-time settings not applied\n");
+        return EXIT_FAILURE;
+    }
+    const int retval = CycleScheduler::makeRealtime(cycle_thread, priority, cpu);
+    if (retval != EXIT_SUCCESS) printf("Could not apply real-time priority %d on cpu %d to cycle thread\n", priority, cpu);
+    else if (verbose) printf("Cycle thread running with priority %d on cpu %d\n", priority, cpu);
+    return retval;
+}
+
+/**
+ * Activate SYNC0 on all DC capable drives and align the master cycle to the
+ * DC reference clock
+ * 
+ * The cycle thread measures the phase of the reference time every cycle and a
+ * PI controller moves the send deadline, so frames pass the drives a fixed time
+ * after SYNC0. Phase error and drift are available in the metrics.
+ * 
+ * @param shift SYNC0 shift in ns relative to the cycle start
+ * 
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ * @note Required before using the cyclic synchronous modes
+ */
+int Master::enableDcSync(int32_t shift){
+    if (!this->inOP){
+        printf("DC synchronisation not possible, master not operational\n");
+        return EXIT_FAILURE;
+    }
+    int synced = 0;
+    for (int i = 1; i <= ec_slavecount; i++){
+        if (ec_slave[i].hasdc && isCmmt(i)){
+            ec_dcsync0(i, TRUE, this->ctime * 1000, shift); // SYNC0 cycle equal to the master cycle
+            synced++;
+        }
+    }
+    if (synced == 0){
+        printf("No DC capable drives found\n");
+        return EXIT_FAILURE;
+    }
+    dcRestart = true;
+    dcActive = true;
+    if (verbose)printf("SYNC0 active on %d drives with cycle %d us\n", synced, this->ctime);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Deactivate SYNC0 and return to free running cycles
+ */
+void Master::disableDcSync(){
+    dcActive = false;
+    for (int i = 1; i <= ec_slavecount; i++){
+        if (ec_slave[i].hasdc && isCmmt(i)) ec_dcsync0(i, FALSE, 0, 0);
+    }
+}
+
+/**
+ * Get the timing and working counter metrics of the cyclic exchange
+ * 
+ * @return Metrics, safe to read while the cycle thread is running
+ * @note Use dumpJson or dumpCsv on the result to export them
+ */
+const CycleMetrics& Master::getMetrics(){
+    return metrics;
+}
+
+/**
+ * Get the number of cycles that missed their deadline
+ * 
+ * @return Number of overruns since startup
+ */
+uint64_t Master::getOverruns(){
+    return scheduler.getOverruns();
+}
+
+/**
+ * Get the digital inputs of a slave
+ * 
+ * @param slaveNr Slave number
+ * 
+ * @return Value of 0x213D:01 in the last cycle
+ */
+uint32_t Master::getInputs(int slaveNr){
+    return get<pdo::Digital_Input_States>(slaveNr);
+}
+
+/**
+ * Get the cycle time of the master
+ * 
+ * @return Cycle time in microseconds
+ */
+uint32_t Master::getCycleTime(){
+    return ctime;
+}
+
+/**
+ * Relate a time to the cyclic exchange
+ * 
+ * Counts whole cycle times from the frame of the last cycle, so times in the
+ * past and the near future are mapped as well.
+ * 
+ * @param time Time from CycleScheduler::now
+ * 
+ * @return Number of the cycle whose frame was the last sent at that time, 0 before the first cycle
+ */
+int64_t Master::cycleAt(int64_t time){
+    const CycleStamp last = getLastCycle();
+    if (last.cycle == 0) return 0;
+
+    const int64_t period = (int64_t)ctime * 1000;
+    int64_t offset = time - last.sent;
+    // Round toward minus infinity, a time before the frame belongs to an earlier cycle
+    int64_t cycles = offset / period;
+    if (offset < 0 && offset % period != 0) cycles--;
+    return (int64_t)last.cycle + cycles;
+}
+
+/**
+ * Get the stamp of the last cycle
+ * 
+ * From a cycle hook this is the cycle the hook runs in.
+ * 
+ * @return Number, send time and DC time of the last exchanged frame
+ */
+CycleStamp Master::getLastCycle(){
+    CycleStamp stamp;
+    uint32_t s;
+    do {
+        s = cycleSeq.readBegin();
+        stamp = lastCycle;
+    } while (cycleSeq.readRetry(s));
+    return stamp;
+}
 
 /**
  * @brief Perform a preconfigured record task by providing the corresponding record number
@@ -772,12 +1406,12 @@ int Master::record_task(int slaveNr, int32_t record){
         setBit(slaveNr, control_4); 
 
         // Bit 12 (Acknowledge new command) Wait till new command is acknowledged
-        while(!getBit(slaveNr, status_ack_start));
+        wait_bits(slaveNr, 1 << status_ack_start, 1 << status_ack_start);
+        unsetControl(slaveNr);
         // Bit 10 (Motion complete) Wait till motion is complete
-        while(!getBit(slaveNr, status_mc)){ 
+        while(!wait_bits(slaveNr, 1 << status_mc, 1 << status_mc, EC_PROGRESSINTERVAL) && inOP){ 
             //print current record number
             if(verbose)printf("Record task: %d is being excuted on Slave %d\r", getRec(slaveNr), slaveNr);
-            unsetControl(slaveNr);
         }
 
         if(verbose)printf("\nRecord task %d completed\n", record);
@@ -808,17 +1442,17 @@ int Master::velocity_task(int slaveNr, int32_t velocity, float duration){
         waitCycle();
         unsetBit(slaveNr, control_halt);
 
-        while(!getBit(slaveNr, status_mc)){
-            if(getBit(slaveNr, status_rc)){
-                printf("Slave %d: Error following velocity limit reached\n", slaveNr);
-                return EXIT_FAILURE;
-            }
-            else if(getBit(slaveNr, status_mc)){
-                printf("Slave %d: Velocity Reached\n", slaveNr);
-                break;
-            }
+        const uint16_t reached = (1 << status_mc) | (1 << status_rc);
+        while(!waitStatus(slaveNr, [reached](uint16_t status){ return (status & reached) != 0; }, EC_PROGRESSINTERVAL) && inOP){
             if(verbose)printf("Velocity task: %d is being excuted on Slave %d\r", velocity, slaveNr);
         }
+        if(getBit(slaveNr, status_rc)){
+            printf("Slave %d: Error following velocity limit reached\n", slaveNr);
+            return EXIT_FAILURE;
+        }
+        else if(getBit(slaveNr, status_mc)){
+            printf("Slave %d: Velocity Reached\n", slaveNr);
+        }
         if(verbose)printf("\n");
         unsetBit(slaveNr, control_halt);
         if (duration > 0) {
@@ -846,18 +1480,18 @@ int Master::velocity_task(int slaveNr, int32_t velocity, float duration){
 int Master::setMode(int slaveNr, uint8_t mode){
     int timeout = 100;
     // Wait for mode to get active
-    while (timeout-- && *(ec_slave[slaveNr].inputs + Mode_of_Operation_Display) != mode){
+    while (timeout-- && get<pdo::Mode_of_Operation_Display>(slaveNr) != mode){
         unsetControl(slaveNr);
         //only change mode if not already in
-        setByte(slaveNr, mode, Mode_of_Operation);
+        set<pdo::Mode_of_Operation>(slaveNr, mode);
         waitCycle();
     }
-    if (*(ec_slave[slaveNr].inputs + Mode_of_Operation_Display) == mode){
+    if (get<pdo::Mode_of_Operation_Display>(slaveNr) == mode){
         unsetControl(slaveNr);
-        if (verbose)printf("Arrived in mode %d\n", *(ec_slave[slaveNr].inputs + Mode_of_Operation_Display));
+        if (verbose)printf("Arrived in mode %d\n", get<pdo::Mode_of_Operation_Display>(slaveNr));
     }        
     else{
-        printf("Failed to change into mode %d\n", *(ec_slave[slaveNr].inputs + Mode_of_Operation_Display));
+        printf("Failed to change into mode %d\n", get<pdo::Mode_of_Operation_Display>(slaveNr));
     }
     return mode;
 }
@@ -879,17 +1513,13 @@ int Master::mapCia402(uint16_t slaveNr){
     // Floating value cycle time in seconds
     float32 ctimeInSeconds = (float32)this->ctime / 1000000;
 
-    // PDO output
-    uint8_t pdoOutputLength = 9; 
-    uint32_t pdoOutput[9] = {0x60400010, 0x60600008, 0x607a0020,
-                             0x60810020, 0x60ff0020, 0x60710010,
-                             0x60b10020, 0x60b20010, 0x00000008};
+    // PDO output, generated from the layout in pdomap.h
+    uint8_t pdoOutputLength = pdo::RxPdo::count; 
+    auto pdoOutput = pdo::RxPdo::mapping();
 
-    // PDO input
-    uint8_t pdoInputLength = 9;
-    uint32_t pdoInput[7] = {0x60410010, 0x60610008, 0x60640020,
-                            0x606c0020, 0x60770010, 0x21940520,
-                            0x00000008 };
+    // PDO input, generated from the layout in pdomap.h
+    uint8_t pdoInputLength = pdo::TxPdo::count;
+    auto pdoInput = pdo::TxPdo::mapping();
 
     
     // Valus for confirming Jurgen Seymoutir explination
@@ -906,8 +1536,9 @@ int Master::mapCia402(uint16_t slaveNr){
     } configSteps[] = {
         {0x212E, 2, sizeof(ctimeInSeconds), &ctimeInSeconds, false}, // Everything cycle time related (should be checked)
         {0x1600, 0, sizeof(pdoOutputLength), &pdoOutputLength, false},  // Write amount of parameters for output
-        {0x1600, 1, sizeof(pdoOutput), pdoOutput, true}, // Step set Output PDOs
+        {0x1600, 1, sizeof(pdoOutput), pdoOutput.data(), true}, // Step set Output PDOs
         {0x1a00, 0, sizeof(pdoInputLength), &pdoInputLength, false}, // Write amount of parameters for input
+        {0x1a00, 1, sizeof(pdoInput), pdoInput.data(), true}, // Step set Input PDOs
         {0x1c12, 1, sizeof(value16_1), &value16_1, false}, // Step 1 confirming Jurgen Seymoutir explination
         {0x1c13, 1, sizeof(value16_2), &value16_2, false},// Step 2 
         {0x1c12, 0, sizeof(value8), &value8, false}, // Step 3
@@ -944,6 +1575,19 @@ void Master::acknowledge_faults(int slaveNr){
         unsetBit(slaveNr, control_fault_reset);
     }
 }
+/**
+ * Check if a slave is a Festo CMMT drive
+ * 
+ * @param slaveNr Slave number
+ * 
+ * @return true for CMMT-AS and CMMT-ST
+ */
+bool Master::isCmmt(int slaveNr){
+    // Check if name is correct for all types of CMMT (not always reliable)
+    return strcmp(ec_slave[slaveNr].name, "CMMT-AS") == 0 || strcmp(ec_slave[slaveNr].name, "CMMT-ST") == 0 || strcmp(ec_slave[slaveNr].name, "FestoCMMT") == 0 ||
+        ec_slave[slaveNr].eep_id == 0x7b5a25 || 0x7b1a95 == ec_slave[slaveNr].eep_id; // Or based on ID
+}
+
 /**
  * Configuring the slave before operational mode
  * 
@@ -951,14 +1595,88 @@ void Master::acknowledge_faults(int slaveNr){
  */
 void Master::setPreOp(int slaveNr){
     printf("Configuring slave %d : %s id : 0x%x\n", slaveNr, ec_slave[slaveNr].name, ec_slave[slaveNr].eep_id);
-    // Check if name is correct for all types of CMMT (not always reliable)
-    if (strcmp(ec_slave[slaveNr].name, "CMMT-AS") == 0 || strcmp(ec_slave[slaveNr].name, "CMMT-ST") == 0 || strcmp(ec_slave[slaveNr].name, "FestoCMMT") == 0 ||
-        ec_slave[slaveNr].eep_id == 0x7b5a25 || 0x7b1a95 == ec_slave[slaveNr].eep_id){ // Or based on ID
+    if (isCmmt(slaveNr)){
         mapCia402(slaveNr);
     }
     
 }
 
+/**
+ * PRE_OP to SAFE_OP hook, maps the PDOs again when a slave is reconfigured
+ * 
+ * @param slaveNr Slave number
+ * 
+ * @return Number of successful writes
+ * @note SOEM hooks have no user pointer, SOEM itself only supports one master per process
+ */
+int Master::remapHook(uint16 slaveNr){
+    return active ? active->mapCia402(slaveNr) : 0;
+}
+
+/**
+ * Supervisor thread, compares the working counter with the expected value and
+ * brings lost or faulty slaves back to operational state
+ * 
+ * Runs next to the cycle thread like ecatcheck in simple_test, the state
+ * handling uses its own mailbox and state frames so the process data
+ * exchange continues while a slave is recovered.
+ */
+void Master::supervise(){
+    while (supervising){
+        if (this->inOP && ((wkc < metrics.expectedWKC.load()) || ec_group[currentgroup].docheckstate)){
+            // One or more slaves are not responding
+            ec_group[currentgroup].docheckstate = FALSE;
+            ec_readstate();
+            for (int slave = 1; slave <= ec_slavecount; slave++){
+                if ((ec_slave[slave].group == currentgroup) && (ec_slave[slave].state != EC_STATE_OPERATIONAL)){
+                    ec_group[currentgroup].docheckstate = TRUE;
+                    if (ec_slave[slave].state == (EC_STATE_SAFE_OP + EC_STATE_ERROR)){
+                        printf("ERROR : slave %d is in SAFE_OP + ERROR, attempting ack.\n", slave);
+                        ec_slave[slave].state = (EC_STATE_SAFE_OP + EC_STATE_ACK);
+                        ec_writestate(slave);
+                    }
+                    else if (ec_slave[slave].state == EC_STATE_SAFE_OP){
+                        printf("WARNING : slave %d is in SAFE_OP, change to OPERATIONAL.\n", slave);
+                        ec_slave[slave].state = EC_STATE_OPERATIONAL;
+                        ec_writestate(slave);
+                    }
+                    else if (ec_slave[slave].state > EC_STATE_NONE){
+                        if (ec_reconfig_slave(slave, EC_TIMEOUTMON)){
+                            ec_slave[slave].islost = FALSE;
+                            metrics.recoveries.fetch_add(1);
+                            printf("MESSAGE : slave %d reconfigured\n", slave);
+                        }
+                    }
+                    else if (!ec_slave[slave].islost){
+                        // Re-check state
+                        ec_statecheck(slave, EC_STATE_OPERATIONAL, EC_TIMEOUTRET);
+                        if (ec_slave[slave].state == EC_STATE_NONE){
+                            ec_slave[slave].islost = TRUE;
+                            metrics.lostSlaves.fetch_add(1);
+                            printf("ERROR : slave %d lost\n", slave);
+                        }
+                    }
+                }
+                if (ec_slave[slave].islost){
+                    if (ec_slave[slave].state == EC_STATE_NONE){
+                        if (ec_recover_slave(slave, EC_TIMEOUTMON)){
+                            ec_slave[slave].islost = FALSE;
+                            metrics.recoveries.fetch_add(1);
+                            printf("MESSAGE : slave %d recovered\n", slave);
+                        }
+                    }
+                    else{
+                        ec_slave[slave].islost = FALSE;
+                        printf("MESSAGE : slave %d found\n", slave);
+                    }
+                }
+            }
+            if (!ec_group[currentgroup].docheckstate) printf("OK : all slaves resumed OPERATIONAL.\n");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
 /**
  * Startup function for the EtherCat Master
  * 
@@ -975,6 +1693,12 @@ int Master::startup(){
         if(verbose)printf("%d slaves found and configured.\n", ec_slavecount);
         ec_config_map(&IOmap); // Make shadow coppy of online data
 
+        // Map again when the supervisor has to reconfigure a drive
+        active = this;
+        for (int i = 1; i <= ec_slavecount; i++){
+            if (isCmmt(i)) ec_slave[i].PO2SOconfig = &Master::remapHook;
+        }
+
         ec_configdc();
 
         for (int i = 1; i <= ec_slavecount; i++){
@@ -990,6 +1714,7 @@ int Master::startup(){
                                                             ec_group[0].IOsegment[2], ec_group[0].IOsegment[3]);
         if (verbose)printf("Request operational state for all slaves\n");
         int expectedWKC = (ec_group[0].outputsWKC * 2) + ec_group[0].inputsWKC;
+        metrics.expectedWKC = expectedWKC;
         if (verbose)printf("Calculated workcounter %d\n", expectedWKC);
         ec_slave[0].state = EC_STATE_OPERATIONAL;
         // Request OP state for all slaves
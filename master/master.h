@@ -11,8 +11,54 @@
 #include"ethercat.h"
 #include<thread>
 #include<mutex>
+#include<condition_variable>
+#include<future>
+#include<deque>
+#include<memory>
+#include<functional>
+#include<vector>
+#include"cyclescheduler.h"
+#include"processimage.h"
+#include"pdomap.h"
+#include"metrics.h"
+#include"dcsync.h"
+#include"spscring.h"
+#include"seqlock.h"
 
 constexpr int EC_TIMEOUTMON = 500;
+constexpr int64_t EC_DCSENDOFFSET = 50000; // Frame passes the drives 50 us after SYNC0, as in red_test
+constexpr uint32_t EC_PROGRESSINTERVAL = 100; // Interval in ms for progress output while waiting
+constexpr uint32_t EC_ACKTIMEOUT = 100; // Time in ms for a drive to acknowledge a new set-point
+constexpr uint32_t EC_MOVEMARGIN = 1000; // Time in ms a queued move may take on top of twice its time at profile velocity
+
+/**
+ * @brief Profile position move handed to @see Master::submit
+ */
+struct MotionCommand {
+    int slaveNr;        // Slave to move
+    int32_t target;     // Target position
+    uint32_t velocity;  // Profile velocity, 0 keeps the velocity of the previous move
+    bool absolute;      // Absolute or relative(false) movement
+};
+
+/**
+ * @brief Setpoint for cyclic synchronous position mode, @see Master::csp_push
+ */
+struct CspSetpoint {
+    int32_t position; // Position at the end of the segment
+    uint32_t cycles;  // Cycles to interpolate over from the previous setpoint, 0 or 1 jumps in the next cycle
+};
+
+constexpr size_t CSP_BUFFER = 1024; // Setpoints buffered per drive
+
+/**
+ * @brief When the frame of a cycle was exchanged, @see Master::getLastCycle
+ */
+struct CycleStamp {
+    uint64_t cycle; // Number of the cycle, counted from 1, 0 before the first cycle
+    int64_t sent;   // Time of CycleScheduler::now the frame was sent
+    int64_t dcTime; // DC system time of the reference clock latched by the frame in ns, 0 without DC
+};
 
 /**
  * @brief  This class is used to control the EtherCAT Master
@@ -50,20 +96,10 @@ class Master
         status_ref = 15, //drive homed
     }statusword_bit_t;
     typedef enum {
-        Controlword = 0,
-        Statusword = 0,
-        Mode_of_Operation = 2,
-        Mode_of_Operation_Display = 2,
-        Target_Position = 3,
-        Position_Actual_Value = 3,
-        Profile_velocity = 7,
-        Target_velocity = 11,
-        Velocity_Actual_Value = 11,
-        Target_Torque = 15,
-        Torque_Actual_Value = 15,
-        Velocity_Offset = 17,
-        Torque_Offset = 21,
-    }mapped_PDO_t;
+        Controlword = pdo::RxPdo::offset<pdo::Controlword>(),
+        Statusword = pdo::TxPdo::offset<pdo::Statusword>(),
+    }mapped_PDO_t; // Words addressed bit by bit, all other objects go through get/set
+    static constexpr uint16_t control_mode_bits = (1 << control_4) | (1 << control_5) | (1 << control_6) | (1 << control_9); // Cleared by unsetControl
     typedef enum {
         no_mode = 0,
         profile_position_mode = 1,
@@ -92,6 +128,13 @@ class Master
         int32_t getPos(int slaveNr);
         int32_t getRec(int slaveNr);
         bool connected(); // Check if drives are ready to use (in operation mode)
+        template<typename Entry> typename Entry::type get(int slaveNr); // Typed read of a TxPDO object
+        uint64_t getOverruns(); // Number of cycles that missed their deadline
+        uint32_t getCycleTime(); // Cycle time in microseconds
+        int64_t cycleAt(int64_t time); // Cycle whose frame was the last sent at a time of CycleScheduler::now
+        CycleStamp getLastCycle(); // Number, send time and DC time of the last cycle
+        uint32_t getInputs(int slaveNr); // Digital inputs (0x213D:01) of the last cycle
+        const CycleMetrics& getMetrics(); // Cycle timing and working counter statistics
 
         
         // control
@@ -106,18 +149,70 @@ class Master
         int position_task(int slaveNr, int32_t target, uint32_t velocity, bool absolute = false, bool nonblocking = false);
         int position_task(int slaveNr, int32_t target, uint32_t velocity, uint32_t acceleration, uint32_t deceleration, bool absolute = false, bool nonblocking = false);
         int velocity_task(int slaveNr, int32_t velocity, float duration);
+        std::future<int> submit(const MotionCommand& command); // Queue a move, completed by the cycle thread
         bool wait_for_target_position(int slaveNr);
+        bool wait_bits(int slaveNr, uint16_t mask, uint16_t value, uint32_t timeout = 0); // Wait for statusword bits
+        bool wait_inputs(int slaveNr, uint32_t mask, uint32_t value, uint32_t timeout = 0); // Wait for digital inputs
+        uint32_t setOutputs(int slaveNr, uint32_t set, uint32_t clear); // Digital outputs (0x60FE:01) for the next cycle
+        void cycleOutputs(int slaveNr, uint32_t set, uint32_t clear); // setOutputs for cycle hooks, never waits
         int reset(int slaveNr);
         void waitCycle(); // Wait for the cycle time
         void acknowledge_faults(int slaveNr);
         void write_sdo(uint16 slaveNr, uint16 index, uint8 subindex, void *value, int valueSize);
         void read_sdo(uint16 slaveNr, uint16 index, uint8 subindex, void *value, int *valueSize);
+        int setRealtime(int priority, int cpu = -1); // Run the cycle thread with real-time priority
+        int enableDcSync(int32_t shift = 0); // Activate SYNC0 and align the cycle to the DC reference
+        void disableDcSync();
+
+        // Cyclic synchronous position streaming
+        int csp_start(int slaveNr);
+        bool csp_push(int slaveNr, const CspSetpoint& setpoint);
+        size_t csp_free(int slaveNr);
+        bool csp_done(int slaveNr);
+        bool csp_active(int slaveNr);
+        void csp_stop(int slaveNr);
+
+        // Application code run by the cycle thread after the inputs are captured
+        int addCycleHook(std::function<void()> hook);
+        void removeCycleHook(int id);
 
     private:
         uint32_t ctime; // Store the cycle time in microseconds
-        std::mutex m; // prevent acces to EC data at the same time
+        std::mutex m; // serialise mailbox access from the application
         
-        char IOmap[4096];
+        alignas(8) char IOmap[PROCESS_IMAGE_SIZE];
+        ProcessImage image; // Staged outputs and input snapshot shared with the cycle thread
+
+        std::mutex statusMutex; // Only guards the wake-up of status waiters
+        std::condition_variable statusChanged; // Notified by the cycle thread when a statusword or digital input changes
+        uint16_t lastStatus[EC_MAXSLAVE] = {};
+        uint32_t lastInputs[EC_MAXSLAVE] = {};
+        bool notifyPending = false; // Change not notified yet because a waiter held statusMutex, cycle thread only
+
+        // Motion command queue and profile position state machine of one drive
+        struct Axis {
+            typedef enum { idle, mode, arm, ack, moving } state_t;
+            std::mutex lock; // Taken by submit, only tried by the cycle thread
+            std::deque<std::pair<MotionCommand, std::promise<int>>> queue;
+            MotionCommand command;
+            std::promise<int> done;
+            std::atomic<state_t> state{idle}; // Written by the cycle thread, read by csp_start
+            uint32_t ticks = 0; // Cycles spent in the current state
+            uint32_t limit = 0; // Cycles the current move may take
+            uint32_t velocity = 0; // Profile velocity of the last move, kept by the drive
+
+            // Cyclic synchronous position, setpoints are produced by one application thread
+            std::atomic<bool> csp{false};
+            std::unique_ptr<SpscRing<CspSetpoint, CSP_BUFFER>> setpoints;
+            int64_t segmentStart = 0;
+            int64_t segmentTarget = 0;
+            uint32_t segmentCycles = 0;
+            uint32_t segmentLeft = 0;
+            int32_t setpoint = 0; // Last position written to the drive
+            uint64_t pushed = 0; // Segments pushed, producer side
+            std::atomic<uint64_t> completed{0}; // Segments finished by the cycle thread
+        };
+        Axis axes[EC_MAXSLAVE];
         volatile int wkc;
 
         bool inOP;
@@ -134,14 +229,26 @@ class Master
         uint8_t unsetBit(int slaveNr, uint8_t bit, uint8_t byte = Controlword);
         uint16_t unsetControl(int slaveNr);
         bool getBit(int slaveNr, uint8_t bit, uint8_t byte = Statusword);
+        uint8_t getByte(int slaveNr, uint8_t byte);
+        uint32_t outputOffset(int slaveNr);
+        uint32_t inputOffset(int slaveNr);
         void setByte(int slaveNr, uint8_t value, uint8_t byte = Controlword);
         void set16(int slaveNr, int16_t value, uint8_t byte);
-        void setPos(int slaveNr, int32_t target, uint8_t byte = Target_Position);
-        void setProfileVelocity(int slaveNr, uint32_t velocity, uint8_t byte = Profile_velocity);
-        void setTargetVelocity(int slaveNr, uint32_t velocity, uint8_t byte = Target_velocity);
+        void setPos(int slaveNr, int32_t target);
+        void setProfileVelocity(int slaveNr, uint32_t velocity);
+        void setTargetVelocity(int slaveNr, int32_t velocity);
+        template<typename Entry> void set(int slaveNr, typename Entry::type value); // Typed write of a RxPDO object
+        template<typename Entry> void cycleSet(int slaveNr, typename Entry::type value); // set for the cycle thread
+        void cycleControl(int slaveNr, uint16_t set, uint16_t clear); // Controlword bits from the cycle thread
         void setRec(int slaveNr, int32_t record);
         int  startup();
         void cycle(); // send and recieve data, wait cycletime 
+        void notifyStatus(); // Wake status waiters on statusword and digital input changes
+        void stepAxes(); // Advance the motion command state machines by one cycle
+        void stepAxis(int slaveNr, Axis& axis);
+        void stepCsp(int slaveNr, Axis& axis);
+        void abortAxes(); // Fail all queued and active motion commands
+        template<typename Pred> bool waitStatus(int slaveNr, Pred pred, uint32_t timeout);
         int  setMode(int slaveNr, uint8_t mode);
 
         // create PDO's
@@ -149,9 +256,84 @@ class Master
         
         // Ethercat state
         void setPreOp(int slaveNr);
+        bool isCmmt(int slaveNr);
+        static int remapHook(uint16 slaveNr);
+        static Master* active; // Master used by the SOEM hooks
+        void supervise(); // Working counter check and slave recovery
 
         //Thread
         std::thread cycle_thread;
+        std::thread supervisor_thread;
+        std::atomic<bool> supervising{false};
+        CycleScheduler scheduler; // Absolute deadline pacing of the cycle thread
+        CycleMetrics metrics; // Written by the cycle thread only
+        SeqLock cycleSeq; // Guards the stamp of the last cycle
+        CycleStamp lastCycle = {};
+        DcSync dcsync; // Only used by the cycle thread
+        std::atomic<bool> dcActive{false};
+        std::atomic<bool> dcRestart{false};
+        std::mutex hookMutex; // Taken by add/remove, only tried by the cycle thread
+        std::vector<std::pair<int, std::function<void()>>> hooks;
+        int nextHook = 0;
+        void runHooks();
 };
 
+/**
+ * Read an object from the inputs of the last cycle
+ * 
+ * @param slaveNr Slave number
+ * 
+ * @return Value of the object, e.g. get<pdo::Position_Actual_Value>(1)
+ */
+template<typename Entry>
+typename Entry::type Master::get(int slaveNr){
+    return image.load<typename Entry::type>(inputOffset(slaveNr) + pdo::TxPdo::offset<Entry>());
+}
+
+/**
+ * Stage an object for the outputs of the next cycle
+ * 
+ * @param slaveNr Slave number
+ * @param value Value of the object, e.g. set<pdo::Target_Position>(1, 90000)
+ */
+template<typename Entry>
+void Master::set(int slaveNr, typename Entry::type value){
+    image.store<typename Entry::type>(outputOffset(slaveNr) + pdo::RxPdo::offset<Entry>(), value);
+}
+
+/**
+ * Write an object for the next cycle from the cycle thread
+ * 
+ * Goes through the overlay of the process image, so the cycle thread never
+ * waits for an application thread that is staging outputs.
+ * 
+ * @param slaveNr Slave number
+ * @param value Value of the object
+ */
+template<typename Entry>
+void Master::cycleSet(int slaveNr, typename Entry::type value){
+    image.overlayStore<typename Entry::type>(outputOffset(slaveNr) + pdo::RxPdo::offset<Entry>(), value);
+}
+
+/**
+ * Block until the statusword of a slave fulfils a condition
+ * 
+ * The condition is checked again every time the cycle thread reports a
+ * changed statusword, so the waiter wakes in the cycle the bit changed.
+ * 
+ * @param slaveNr Slave number
+ * @param pred Condition on the statusword
+ * @param timeout Timeout in milliseconds, 0 waits forever
+ * 
+ * @return true if the condition is met, false on timeout or when the master stops
+ */
+template<typename Pred>
+bool Master::waitStatus(int slaveNr, Pred pred, uint32_t timeout){
+    auto done = [&]{ return pred(get<pdo::Statusword>(slaveNr)) || !this->inOP; };
+    std::unique_lock<std::mutex> lock(statusMutex);
+    if (timeout == 0) statusChanged.wait(lock, done);
+    else statusChanged.wait_for(lock, std::chrono::milliseconds(timeout), done);
+    return this->inOP && pred(get<pdo::Statusword>(slaveNr));
+}
+
 #endif // MASTER_H
\ No newline at end of file
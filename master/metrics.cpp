@@ -0,0 +1,202 @@
+// metrics.cpp
+#include "metrics.h"
+
+#include <cmath>
+#include <limits>
+
+/**
+ * Constructor for an empty histogram
+ */
+Histogram::Histogram(){
+    reset();
+}
+
+/**
+ * Clear all recorded values
+ *
+ * @note Not atomic as a whole, values recorded meanwhile may be lost
+ */
+void Histogram::reset(){
+    for (int i = 0; i < BUCKETS; i++) counts[i].store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    minimum.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+    maximum.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * Record one value
+ *
+ * @param value Value to record, negative values count as 0
+ */
+void Histogram::record(int64_t value){
+    if (value < 0) value = 0;
+    counts[indexOf(value)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    int64_t current = minimum.load(std::memory_order_relaxed);
+    while (value < current && !minimum.compare_exchange_weak(current, value, std::memory_order_relaxed));
+    current = maximum.load(std::memory_order_relaxed);
+    while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed));
+
+    total.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @return Number of recorded values
+ */
+uint64_t Histogram::count() const {
+    return total.load(std::memory_order_acquire);
+}
+
+/**
+ * @return Smallest recorded value, 0 if empty
+ */
+int64_t Histogram::min() const {
+    return count() ? minimum.load(std::memory_order_relaxed) : 0;
+}
+
+/**
+ * @return Largest recorded value
+ */
+int64_t Histogram::max() const {
+    return maximum.load(std::memory_order_relaxed);
+}
+
+/**
+ * @return Mean of the recorded values, 0 if empty
+ */
+double Histogram::mean() const {
+    const uint64_t n = count();
+    return n ? (double)sum.load(std::memory_order_relaxed) / n : 0.0;
+}
+
+/**
+ * Value below which a given percentage of the recorded values fall
+ *
+ * @param p Percentile between 0 and 100
+ *
+ * @return Upper bound of the bucket holding the percentile, at most the maximum
+ */
+int64_t Histogram::percentile(double p) const {
+    const uint64_t n = count();
+    if (n == 0) return 0;
+    uint64_t target = (uint64_t)std::ceil(p / 100.0 * n);
+    if (target < 1) target = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++){
+        seen += counts[i].load(std::memory_order_relaxed);
+        if (seen >= target){
+            const int64_t value = valueOf(i);
+            return value < max() ? value : max();
+        }
+    }
+    return max();
+}
+
+/**
+ * Bucket index of a value
+ *
+ * @param value Value, not negative
+ *
+ * @return Index in counts
+ */
+int Histogram::indexOf(int64_t value){
+    const uint64_t v = (uint64_t)value;
+    if (v < (1u << SUB_BITS)) return (int)v;
+
+    int msb = 0;
+    for (uint64_t rest = v; rest >>= 1;) msb++;
+    if (msb > MAX_BITS) return BUCKETS - 1;
+
+    const int bucket = msb - SUB_BITS;
+    return ((bucket + 1) << SUB_BITS) + (int)((v >> bucket) - (1u << SUB_BITS));
+}
+
+/**
+ * Largest value that falls into a bucket
+ *
+ * @param index Index in counts
+ *
+ * @return Upper bound of the bucket
+ */
+int64_t Histogram::valueOf(int index){
+    if (index < (1 << SUB_BITS)) return index;
+    const int bucket = (index >> SUB_BITS) - 1;
+    const int64_t sub = (index & ((1 << SUB_BITS) - 1)) + (1 << SUB_BITS);
+    return ((sub + 1) << bucket) - 1;
+}
+
+/**
+ * Clear all histograms and counters
+ */
+void CycleMetrics::reset(){
+    wakeupJitter.reset();
+    send.reset();
+    roundtrip.reset();
+    dcOffset.reset();
+    cycles.store(0);
+    overruns.store(0);
+    wkcMismatches.store(0);
+    lostSlaves.store(0);
+    recoveries.store(0);
+}
+
+/**
+ * Write one histogram as a JSON object
+ */
+static void histogramJson(std::ostream& out, const char* name, const Histogram& h){
+    out << "\"" << name << "\":{\"count\":" << h.count() << ",\"min\":" << h.min() << ",\"mean\":" << h.mean()
+        << ",\"p50\":" << h.percentile(50) << ",\"p90\":" << h.percentile(90) << ",\"p99\":" << h.percentile(99)
+        << ",\"p99.9\":" << h.percentile(99.9) << ",\"max\":" << h.max() << "}";
+}
+
+/**
+ * Write one histogram as a CSV line
+ */
+static void histogramCsv(std::ostream& out, const char* name, const Histogram& h){
+    out << name << "," << h.count() << "," << h.min() << "," << h.mean() << "," << h.percentile(50) << ","
+        << h.percentile(90) << "," << h.percentile(99) << "," << h.percentile(99.9) << "," << h.max() << "\n";
+}
+
+/**
+ * Dump all metrics as one JSON object, times in nanoseconds
+ *
+ * @param out Stream to write to
+ */
+void CycleMetrics::dumpJson(std::ostream& out) const {
+    out << "{\"cycles\":" << cycles.load() << ",\"overruns\":" << overruns.load()
+        << ",\"wkc_expected\":" << expectedWKC.load() << ",\"wkc_last\":" << lastWKC.load()
+        << ",\"wkc_mismatches\":" << wkcMismatches.load() << ",\"lost_slaves\":" << lostSlaves.load()
+        << ",\"recoveries\":" << recoveries.load() << ",\"dc_offset_ns\":" << dcOffsetNs.load()
+        << ",\"dc_drift_ns\":" << dcDriftNs.load() << ",";
+    histogramJson(out, "wakeup_jitter_ns", wakeupJitter);
+    out << ",";
+    histogramJson(out, "send_ns", send);
+    out << ",";
+    histogramJson(out, "roundtrip_ns", roundtrip);
+    out << ",";
+    histogramJson(out, "dc_offset_ns", dcOffset);
+    out << "}\n";
+}
+
+/**
+ * Dump all metrics as CSV, one line per histogram followed by the counters
+ *
+ * @param out Stream to write to
+ */
+void CycleMetrics::dumpCsv(std::ostream& out) const {
+    out << "metric,count,min,mean,p50,p90,p99,p99.9,max\n";
+    histogramCsv(out, "wakeup_jitter_ns", wakeupJitter);
+    histogramCsv(out, "send_ns", send);
+    histogramCsv(out, "roundtrip_ns", roundtrip);
+    histogramCsv(out, "dc_offset_ns", dcOffset);
+    out << "cycles," << cycles.load() << ",,,,,,,\n";
+    out << "overruns," << overruns.load() << ",,,,,,,\n";
+    out << "wkc_mismatches," << wkcMismatches.load() << ",,,,,,,\n";
+    out << "lost_slaves," << lostSlaves.load() << ",,,,,,,\n";
+    out << "recoveries," << recoveries.load() << ",,,,,,,\n";
+    out << "dc_offset_ns," << dcOffsetNs.load() << ",,,,,,,\n";
+    out << "dc_drift_ns," << dcDriftNs.load() << ",,,,,,,\n";
+}
@@ -0,0 +1,71 @@
+// metrics.h
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @brief Log-linear histogram with lock-free recording
+ *
+ * Values below 2^SUB_BITS get their own bucket, above that every power of two is
+ * split into 2^SUB_BITS linear buckets, so the relative error stays below 1/32.
+ * Recording only does relaxed atomic increments, it is safe from the cycle thread
+ * while other threads read percentiles.
+ */
+class Histogram {
+    public:
+        static constexpr int SUB_BITS = 5;
+        static constexpr int MAX_BITS = 40; // Values up to 2^40 (about 18 minutes in ns)
+        static constexpr int BUCKETS = (MAX_BITS - SUB_BITS + 2) << SUB_BITS;
+
+        Histogram();
+
+        void record(int64_t value);
+        void reset();
+
+        uint64_t count() const;
+        int64_t min() const;
+        int64_t max() const;
+        double mean() const;
+        int64_t percentile(double p) const;
+
+    private:
+        std::atomic<uint64_t> counts[BUCKETS];
+        std::atomic<uint64_t> total;
+        std::atomic<int64_t> sum;
+        std::atomic<int64_t> minimum;
+        std::atomic<int64_t> maximum;
+
+        static int indexOf(int64_t value);
+        static int64_t valueOf(int index);
+};
+
+/**
+ * @brief Timing and health figures of the cyclic exchange
+ *
+ * Written by the cycle thread, readable from any thread at any time.
+ */
+struct CycleMetrics {
+    Histogram wakeupJitter; // Wake-up time after the deadline in ns
+    Histogram send;         // Duration of ec_send_processdata in ns
+    Histogram roundtrip;    // Send start until receive complete in ns
+    Histogram dcOffset;     // Absolute phase error to the DC reference in ns, only with DC sync
+
+    std::atomic<uint64_t> cycles{0};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> wkcMismatches{0};
+    std::atomic<int> expectedWKC{0};
+    std::atomic<int> lastWKC{0};
+    std::atomic<uint64_t> lostSlaves{0};  // Slaves that stopped responding
+    std::atomic<uint64_t> recoveries{0};  // Slaves brought back by the supervisor
+    std::atomic<int64_t> dcOffsetNs{0};   // Last phase error to the DC reference
+    std::atomic<int64_t> dcDriftNs{0};    // Drift correction in ns per cycle
+
+    void reset();
+    void dumpJson(std::ostream& out) const;
+    void dumpCsv(std::ostream& out) const;
+};
+
+#endif // METRICS_H
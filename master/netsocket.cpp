@@ -0,0 +1,217 @@
+// netsocket.cpp
+#include "netsocket.h"
+
+#include <cstdlib>
+
+#if defined(_WIN32)
+    #include <mstcpip.h>
+    typedef int socklen_t;
+#else
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <netinet/tcp.h>
+    #include <sys/select.h>
+    #include <unistd.h>
+#endif
+
+namespace net {
+
+/**
+ * Initialize the socket library, may be called more than once
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int startup(){
+#if defined(_WIN32)
+    // WinSock counts the calls, every startup needs a cleanup
+    WSADATA wsaData;
+    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+#else
+    return EXIT_SUCCESS;
+#endif
+}
+
+/**
+ * Release the socket library, once for every successful startup
+ */
+void cleanup(){
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+/**
+ * @return Error code of the last failed socket call
+ */
+int lastError(){
+#if defined(_WIN32)
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+/**
+ * @return true if the error only means the call would have blocked
+ */
+bool wouldBlock(int error){
+#if defined(_WIN32)
+    return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+#else
+    return error == EAGAIN || error == EWOULDBLOCK || error == EINPROGRESS || error == EINTR;
+#endif
+}
+
+/**
+ * @return 0 on success, SOCKET_ERROR otherwise
+ */
+int closeSocket(socket_t socket){
+#if defined(_WIN32)
+    return closesocket(socket);
+#else
+    return close(socket);
+#endif
+}
+
+/**
+ * Switch a socket between blocking and non-blocking calls
+ *
+ * @return 0 on success, SOCKET_ERROR otherwise
+ */
+int setNonBlocking(socket_t socket, bool nonBlocking){
+#if defined(_WIN32)
+    u_long mode = nonBlocking ? 1 : 0;
+    return ioctlsocket(socket, FIONBIO, &mode);
+#else
+    const int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0) return SOCKET_ERROR;
+    return fcntl(socket, F_SETFL, nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+#endif
+}
+
+/**
+ * Send small messages right away instead of waiting to fill a segment
+ *
+ * @return 0 on success, SOCKET_ERROR otherwise
+ */
+int setNoDelay(socket_t socket){
+    int on = 1;
+    return setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+}
+
+/**
+ * Round trip time the TCP stack measured on a connection
+ *
+ * Only known once data was sent and acknowledged on the socket.
+ *
+ * @return Smoothed round trip in ns, -1 if the system does not provide it
+ */
+int64_t roundTrip(socket_t socket){
+#if defined(__linux__)
+    tcp_info info = {};
+    socklen_t length = sizeof(info);
+    if (getsockopt(socket, IPPROTO_TCP, TCP_INFO, &info, &length) != 0) return -1;
+    return (int64_t)info.tcpi_rtt * 1000;
+#elif defined(_WIN32) && defined(SIO_TCP_INFO)
+    DWORD version = 0;
+    TCP_INFO_v0 info = {};
+    DWORD length = 0;
+    if (WSAIoctl(socket, SIO_TCP_INFO, &version, sizeof(version), &info, sizeof(info), &length, nullptr, nullptr) != 0) return -1;
+    return (int64_t)info.RttUs * 1000;
+#else
+    (void)socket;
+    return -1;
+#endif
+}
+
+/**
+ * Connect to a TCP server, giving up after a timeout
+ *
+ * @param ip IPv4 address of the server
+ * @param port Port of the server
+ * @param timeout Time in ms to wait for the connection
+ *
+ * @return Connected socket in non-blocking mode, INVALID_SOCKET on failure
+ */
+socket_t connectTo(const char* ip, int port, uint32_t timeout){
+    socket_t client = socket(AF_INET, SOCK_STREAM, 0);
+    if (client == INVALID_SOCKET) return INVALID_SOCKET;
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, ip, &address.sin_addr) != 1 || setNonBlocking(client, true) != 0) {
+        closeSocket(client);
+        return INVALID_SOCKET;
+    }
+
+    if (connect(client, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
+        if (!wouldBlock(lastError())) {
+            closeSocket(client);
+            return INVALID_SOCKET;
+        }
+
+        // Connected once writable, the result of the attempt is in SO_ERROR
+        fd_set writeSet;
+        FD_ZERO(&writeSet);
+        FD_SET(client, &writeSet);
+        timeval wait = {(long)(timeout / 1000), (long)(timeout % 1000) * 1000};
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (select((int)client + 1, nullptr, &writeSet, nullptr, &wait) != 1
+            || getsockopt(client, SOL_SOCKET, SO_ERROR, (char*)&error, &length) != 0 || error != 0) {
+            closeSocket(client);
+            return INVALID_SOCKET;
+        }
+    }
+    setNoDelay(client);
+    return client;
+}
+
+/**
+ * Listen for TCP connections on all interfaces
+ *
+ * @param port Port to listen on
+ *
+ * @return Listening socket, INVALID_SOCKET on failure
+ */
+socket_t listenOn(int port){
+    socket_t server = socket(AF_INET, SOCK_STREAM, 0);
+    if (server == INVALID_SOCKET) return INVALID_SOCKET;
+
+    // Allow restarting right away while old connections are in TIME_WAIT
+    int on = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(server, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR || listen(server, 1) == SOCKET_ERROR) {
+        closeSocket(server);
+        return INVALID_SOCKET;
+    }
+    return server;
+}
+
+/**
+ * Send without raising SIGPIPE when the peer is gone
+ *
+ * @return Bytes sent, SOCKET_ERROR on failure
+ */
+int sendBytes(socket_t socket, const char* data, size_t size){
+#if defined(MSG_NOSIGNAL)
+    return (int)send(socket, data, size, MSG_NOSIGNAL);
+#else
+    return (int)send(socket, data, (int)size, 0);
+#endif
+}
+
+/**
+ * @return Bytes received, 0 if the peer closed the connection, SOCKET_ERROR on failure
+ */
+int receiveBytes(socket_t socket, char* data, size_t size){
+    return (int)recv(socket, data, (int)size, 0);
+}
+
+} // namespace net
@@ -0,0 +1,47 @@
+// netsocket.h
+#ifndef NETSOCKET_H
+#define NETSOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_WIN32)
+    #include <WinSock2.h>
+    #include <WS2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+    typedef SOCKET socket_t;
+#else
+    #include <arpa/inet.h>
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+    typedef int socket_t;
+    #define INVALID_SOCKET (-1)
+    #define SOCKET_ERROR (-1)
+#endif
+
+/**
+ * @brief Thin layer over WinSock and POSIX sockets
+ *
+ * Only covers what the camera clients and the camera stand-in need, so the
+ * same code builds on Windows and Linux.
+ */
+namespace net {
+
+int startup(); // WSAStartup on Windows, EXIT_SUCCESS or EXIT_FAILURE
+void cleanup();
+
+int lastError();
+bool wouldBlock(int error); // Operation would block or is still in progress
+int closeSocket(socket_t socket);
+int setNonBlocking(socket_t socket, bool nonBlocking);
+int setNoDelay(socket_t socket);
+int64_t roundTrip(socket_t socket); // Smoothed TCP round trip in ns, -1 if unknown
+
+socket_t connectTo(const char* ip, int port, uint32_t timeout);
+socket_t listenOn(int port);
+int sendBytes(socket_t socket, const char* data, size_t size);
+int receiveBytes(socket_t socket, char* data, size_t size);
+
+} // namespace net
+
+#endif // NETSOCKET_H
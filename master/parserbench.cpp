@@ -0,0 +1,110 @@
+// parserbench.cpp
+// Compares Camera::parseDetections with the streaming ResultParser on the same result stream,
+// generated or taken from a camera recording
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "camera.h"
+#include "camerarecorder.h"
+#include "resultparser.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * Result messages like the camera sends them, values in thousandths
+ */
+std::vector<std::string> corpus(size_t messages, int objects){
+    std::mt19937 random(2005);
+    std::uniform_int_distribution<int> x(300000, 450000);
+    std::uniform_int_distribution<int> y(-120000, 120000);
+    std::uniform_int_distribution<int> angle(-90000, 90000);
+    std::vector<std::string> result(messages);
+    for (std::string& message : result) {
+        for (int i = 0; i < objects; i++) {
+            message += std::to_string(x(random)) + ";" + std::to_string(y(random)) + ";" + std::to_string(angle(random)) + ";";
+        }
+        message += "\r\n";
+    }
+    return result;
+}
+
+/**
+ * Result messages of a recording, timeouts left out
+ */
+std::vector<std::string> recorded(const std::vector<CameraRecord>& records){
+    std::vector<std::string> result;
+    for (const CameraRecord& record : records) {
+        if (record.latency >= 0) result.push_back(record.payload + "\n");
+    }
+    return result;
+}
+
+/**
+ * Parse the stream in reads of a fixed size
+ *
+ * @return Sum of all x to compare the parsers and keep the work
+ */
+double streaming(ResultParser& parser, const std::string& stream, size_t read, size_t& messages){
+    double sum = 0;
+    auto handler = [&sum](const ResultParser::Message& message) {
+        for (size_t i = 0; i < message.count; i++) sum += message.detections[i].x;
+    };
+    for (size_t offset = 0; offset < stream.size(); offset += read) {
+        const size_t size = stream.size() - offset < read ? stream.size() - offset : read;
+        messages += parser.feed(stream.data() + offset, size, handler);
+    }
+    return sum;
+}
+
+int main(int argc, char* argv[]){
+    std::vector<std::string> messages;
+    if (argc > 2 && std::string(argv[1]) == "--replay") {
+        std::vector<CameraRecord> records;
+        if (CameraRecorder::load(argv[2], records) != EXIT_SUCCESS && records.empty()) {
+            std::cerr << "Error reading camera recording " << argv[2] << std::endl;
+            return EXIT_FAILURE;
+        }
+        messages = recorded(records);
+        if (messages.empty()) {
+            std::cerr << "Error: No results in " << argv[2] << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Recording " << argv[2] << ", ";
+    } else {
+        const size_t generated = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+        const int objects = argc > 2 ? std::atoi(argv[2]) : 3;
+        messages = corpus(generated, objects);
+        std::cout << objects << " objects per message, ";
+    }
+    const size_t count = messages.size();
+    std::string stream;
+    for (const std::string& message : messages) stream += message;
+
+    std::cout << count << " messages, " << stream.size() << " bytes" << std::endl;
+
+    // One message per read, as Camera::receiveDetections assumes
+    Clock::time_point start = Clock::now();
+    double sum = 0;
+    for (const std::string& message : messages) {
+        for (const Detection& detection : Camera::parseDetections(message)) sum += detection.x;
+    }
+    const double baseline = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+    std::cout << "parseDetections          " << baseline << " ns/message (sum " << sum << ")" << std::endl;
+
+    // Whole reads of a segment, 7 bytes to split nearly every number, and everything at once
+    const size_t reads[] = {1460, 7, stream.size()};
+    for (size_t read : reads) {
+        ResultParser parser;
+        size_t parsed = 0;
+        start = Clock::now();
+        sum = streaming(parser, stream, read, parsed);
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+        std::cout << "ResultParser, reads of " << read << " " << ns << " ns/message (sum " << sum << ", "
+                  << parsed << " messages, " << parser.getErrors() << " errors) " << baseline / ns << "x" << std::endl;
+        if (parsed != count) return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
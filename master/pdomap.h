@@ -0,0 +1,96 @@
+// pdomap.h
+#ifndef PDOMAP_H
+#define PDOMAP_H
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @brief Compile-time description of the Cia402 PDO mapping of the Festo CMMT drives
+ *
+ * Each object is a type carrying its index, subindex and data type. A Layout lists
+ * the objects in the order they are mapped; it generates the mapping words for the
+ * 0x1600/0x1A00 SDO writes and the byte offset of every object in the process data,
+ * so mapping and accessors cannot get out of step.
+ */
+namespace pdo {
+
+    template<uint16_t Index, uint8_t Subindex, typename T>
+    struct Entry {
+        using type = T;
+        static constexpr uint16_t index = Index;
+        static constexpr uint8_t subindex = Subindex;
+        static constexpr uint8_t bits = sizeof(T) * 8;
+        static constexpr uint32_t mapping = ((uint32_t)Index << 16) | ((uint32_t)Subindex << 8) | bits;
+    };
+
+    template<typename... Entries>
+    struct Layout {
+        static constexpr uint8_t count = sizeof...(Entries);
+        static constexpr uint32_t size = (sizeof(typename Entries::type) + ...);
+
+        // Mapping words in the format of the 0x1600/0x1A00 subindices
+        static constexpr std::array<uint32_t, sizeof...(Entries)> mapping(){
+            return {{Entries::mapping...}};
+        }
+
+        // Byte offset of an object in the process data of one slave
+        template<typename E>
+        static constexpr uint32_t offset(){
+            static_assert((std::is_same<E, Entries>::value || ...), "Object is not part of this PDO layout");
+            const bool match[] = {std::is_same<E, Entries>::value...};
+            const uint32_t sizes[] = {sizeof(typename Entries::type)...};
+            uint32_t off = 0;
+            for (uint32_t i = 0; i < count && !match[i]; i++) off += sizes[i];
+            return off;
+        }
+
+        // True if every object starts on a multiple of its own size
+        static constexpr bool aligned(){
+            const uint32_t sizes[] = {sizeof(typename Entries::type)...};
+            uint32_t off = 0;
+            for (uint32_t i = 0; i < count; i++){
+                if (off % sizes[i] != 0) return false;
+                off += sizes[i];
+            }
+            return true;
+        }
+    };
+
+    // Padding, mapped as index 0
+    struct Padding8 : Entry<0x0000, 0x00, uint8_t> {};
+    struct Padding16 : Entry<0x0000, 0x00, uint16_t> {};
+
+    // Outputs (RxPDO, master to drive)
+    struct Controlword : Entry<0x6040, 0x00, uint16_t> {};
+    struct Target_Torque : Entry<0x6071, 0x00, int16_t> {};
+    struct Target_Position : Entry<0x607A, 0x00, int32_t> {};
+    struct Profile_Velocity : Entry<0x6081, 0x00, uint32_t> {};
+    struct Target_Velocity : Entry<0x60FF, 0x00, int32_t> {};
+    struct Velocity_Offset : Entry<0x60B1, 0x00, int32_t> {};
+    struct Torque_Offset : Entry<0x60B2, 0x00, int16_t> {};
+    struct Mode_of_Operation : Entry<0x6060, 0x00, uint8_t> {};
+    struct Digital_Outputs : Entry<0x60FE, 0x01, uint32_t> {}; // Physical outputs, enabled by the bitmask in 0x60FE:02
+
+    // Inputs (TxPDO, drive to master)
+    struct Statusword : Entry<0x6041, 0x00, uint16_t> {};
+    struct Torque_Actual_Value : Entry<0x6077, 0x00, int16_t> {};
+    struct Position_Actual_Value : Entry<0x6064, 0x00, int32_t> {};
+    struct Velocity_Actual_Value : Entry<0x606C, 0x00, int32_t> {};
+    struct Object_2194_05 : Entry<0x2194, 0x05, int32_t> {}; // Manufacturer specific, kept from the original mapping
+    struct Mode_of_Operation_Display : Entry<0x6061, 0x00, uint8_t> {};
+    struct Digital_Input_States : Entry<0x213D, 0x01, uint32_t> {}; // Manufacturer specific state of the physical inputs, read by SDO before
+
+    // Ordered by size so every object is naturally aligned
+    using RxPdo = Layout<Controlword, Target_Torque, Target_Position, Profile_Velocity, Target_Velocity,
+                         Velocity_Offset, Digital_Outputs, Torque_Offset, Mode_of_Operation, Padding8>;
+    using TxPdo = Layout<Statusword, Torque_Actual_Value, Position_Actual_Value, Velocity_Actual_Value,
+                         Object_2194_05, Digital_Input_States, Mode_of_Operation_Display, Padding8, Padding16>;
+
+    // Keep the size a multiple of 4 so the next slave in the IOmap starts aligned as well
+    static_assert(RxPdo::aligned() && RxPdo::size % 4 == 0, "RxPDO layout is not aligned");
+    static_assert(TxPdo::aligned() && TxPdo::size % 4 == 0, "TxPDO layout is not aligned");
+}
+
+#endif // PDOMAP_H
@@ -0,0 +1,123 @@
+// phasetracer.cpp
+#include "phasetracer.h"
+
+#include <atomic>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include "cyclescheduler.h"
+#include "metrics.h"
+
+/**
+ * Constructor for an empty tracer
+ */
+PhaseTracer::PhaseTracer() : events(CAPACITY), recorded(0) {}
+
+/**
+ * @return Monotonic time in ns, the same clock the cycle thread uses
+ */
+int64_t PhaseTracer::now(){
+    return CycleScheduler::now();
+}
+
+/**
+ * Store a phase that ends now
+ *
+ * Phases that follow each other can be chained: t = tracer.record("a", t);
+ *
+ * @param name Name of the phase, must be a string literal or outlive the tracer
+ * @param start Start of the phase from now()
+ *
+ * @return End of the phase, the start of the next one
+ */
+int64_t PhaseTracer::record(const char* name, int64_t start){
+    const int64_t end = now();
+    const uint32_t thread = threadIndex();
+    std::lock_guard<std::mutex> guard(lock);
+    events[recorded % CAPACITY] = {name, start, end, thread};
+    recorded++;
+    return end;
+}
+
+/**
+ * Forget all recorded phases
+ */
+void PhaseTracer::reset(){
+    std::lock_guard<std::mutex> guard(lock);
+    recorded = 0;
+}
+
+/**
+ * @return Number of phases recorded since the last reset
+ */
+uint64_t PhaseTracer::count(){
+    std::lock_guard<std::mutex> guard(lock);
+    return recorded;
+}
+
+/**
+ * Write duration statistics per phase as CSV, times in nanoseconds
+ *
+ * @param out Stream to write to
+ * @note Only covers the phases still in the buffer
+ */
+void PhaseTracer::dumpSummary(std::ostream& out){
+    std::vector<const char*> names;
+    std::vector<std::unique_ptr<Histogram>> durations;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const uint64_t kept = recorded < CAPACITY ? recorded : CAPACITY;
+        for (uint64_t i = recorded - kept; i < recorded; i++){
+            const Event& event = events[i % CAPACITY];
+            size_t phase = 0;
+            while (phase < names.size() && strcmp(names[phase], event.name) != 0) phase++;
+            if (phase == names.size()){
+                names.push_back(event.name);
+                durations.emplace_back(new Histogram());
+            }
+            durations[phase]->record(event.end - event.start);
+        }
+    }
+
+    out << "phase,count,min,mean,p50,p90,p99,max\n";
+    for (size_t phase = 0; phase < names.size(); phase++){
+        const Histogram& h = *durations[phase];
+        out << names[phase] << "," << h.count() << "," << h.min() << "," << h.mean() << "," << h.percentile(50) << ","
+            << h.percentile(90) << "," << h.percentile(99) << "," << h.max() << "\n";
+    }
+}
+
+/**
+ * Write the phases in the buffer as Chrome trace events
+ *
+ * Every thread gets its own row, times are in microseconds from the oldest phase.
+ *
+ * @param out Stream to write to
+ */
+void PhaseTracer::dumpChromeTrace(std::ostream& out){
+    std::lock_guard<std::mutex> guard(lock);
+    const uint64_t kept = recorded < CAPACITY ? recorded : CAPACITY;
+    const int64_t origin = kept ? events[(recorded - kept) % CAPACITY].start : 0;
+
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    for (uint64_t i = recorded - kept; i < recorded; i++){
+        const Event& event = events[i % CAPACITY];
+        if (i != recorded - kept) out << ",";
+        out << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << (event.start - origin) / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+    }
+    out << "],\"displayTimeUnit\":\"ms\"}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+/**
+ * @return Small number identifying the calling thread, assigned on first use
+ */
+uint32_t PhaseTracer::threadIndex(){
+    static std::atomic<uint32_t> threads{0};
+    thread_local uint32_t index = ++threads;
+    return index;
+}
@@ -0,0 +1,47 @@
+// phasetracer.h
+#ifndef PHASETRACER_H
+#define PHASETRACER_H
+
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief Records how long each phase of the pick and drop cycle takes
+ *
+ * Every phase is stored with its start and end on the monotonic clock in a ring
+ * buffer that keeps the most recent phases. The buffer can be summarised per
+ * phase or exported as a Chrome trace (chrome://tracing, Perfetto) to see how
+ * phases of different threads line up.
+ */
+class PhaseTracer {
+    public:
+        static constexpr uint32_t CAPACITY = 4096; // Phases kept, older ones are overwritten
+
+        PhaseTracer();
+
+        static int64_t now(); // Monotonic time in ns
+        int64_t record(const char* name, int64_t start); // Store a phase ending now, returns now
+        void reset();
+
+        uint64_t count(); // Phases recorded since the last reset, including overwritten ones
+        void dumpSummary(std::ostream& out);
+        void dumpChromeTrace(std::ostream& out);
+
+    private:
+        struct Event {
+            const char* name; // String literal, not copied
+            int64_t start;
+            int64_t end;
+            uint32_t thread;
+        };
+
+        std::mutex lock; // Phases last milliseconds, a mutex costs nothing in comparison
+        std::vector<Event> events; // Ring of CAPACITY phases
+        uint64_t recorded;
+
+        static uint32_t threadIndex();
+};
+
+#endif // PHASETRACER_H
@@ -0,0 +1,198 @@
+// pickengine.cpp
+#include "pickengine.h"
+
+const std::chrono::milliseconds EMPTY_RETRY(100); // Wait before capturing again when nothing was found
+const uint32_t PULSE_TIMEOUT = 100; // Time in ms for the hardware trigger to go out
+
+/**
+ * Constructor that starts the vision thread and requests the first capture.
+ *
+ * @param robot The robot that picks the objects
+ * @param camera Started camera client, its events are taken by the engine
+ * @param master Master the camera latency is counted in cycles of, optional
+ * @param hardware Digital output wired to the trigger input of the camera, nullptr to trigger over TCP
+ *
+ * @note The arm has to be out of the camera field of view when the engine is created
+ */
+PickEngine::PickEngine(SCARA& robot, CameraClient& camera, Master* master, HardwareTrigger* hardware) : robot(robot), camera(camera), latency(master), hardware(hardware), scheduler(robot) {
+    started = std::chrono::steady_clock::now();
+    vision_thread = std::thread(&PickEngine::vision, this);
+    requestCapture();
+}
+
+/**
+ * Stops the vision thread.
+ *
+ * @note Waits for a capture that is being processed to finish
+ */
+PickEngine::~PickEngine() {
+    stop();
+    vision_thread.join();
+}
+
+/**
+ * Picks objects and drops them, the next target is taken from the queue.
+ *
+ * @param picks Number of objects to pick, 0 to pick until stop is called
+ */
+void PickEngine::run(uint64_t picks) {
+    Detection target;
+    for (uint64_t done = 0; picks == 0 || done < picks; done++) {
+        if (!nextTarget(target)) return;
+
+        const uint64_t missed = robot.getVacuumMonitor().getFailures();
+        if (!robot.pickUp(target.x, target.y, target.angle)) {
+            if (robot.getVacuumMonitor().getFailures() != missed) {
+                // Nothing on the gripper, but the arm still has to leave the field of view
+                robot.drop([this]() { captureWhenEmpty(); });
+            } else {
+                // Nothing moved, the arm is still out of view
+                captureWhenEmpty();
+            }
+            continue;
+        }
+
+        // The arm leaves the field of view with the first move of the drop
+        robot.drop([this]() { captureWhenEmpty(); });
+        this->picks++;
+    }
+}
+
+/**
+ * Stops the engine, run returns after the current pick.
+ */
+void PickEngine::stop() {
+    std::lock_guard<std::mutex> guard(lock);
+    running = false;
+    changed.notify_all();
+}
+
+/**
+ * @return Number of objects picked and dropped
+ */
+uint64_t PickEngine::getPicks() {
+    return picks.load();
+}
+
+/**
+ * Throughput since the engine was created.
+ *
+ * @return Picks per minute
+ */
+double PickEngine::picksPerMinute() {
+    const double minutes = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count() / 60.0;
+    return minutes > 0 ? getPicks() / minutes : 0.0;
+}
+
+/**
+ * @return Time from trigger to result of the captures so far
+ */
+const CameraLatency& PickEngine::getCameraLatency() const {
+    return latency;
+}
+
+/**
+ * Vision thread, triggers the camera on request and queues the result.
+ */
+void PickEngine::vision() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        changed.wait(guard, [this]() { return captureRequested || !running; });
+        if (!running) return;
+        captureRequested = false;
+
+        // The camera is slow, do not block the motion side meanwhile
+        guard.unlock();
+        int64_t t = PhaseTracer::now();
+        std::vector<Detection> found = capture();
+        t = robot.getTracer().record("vision.capture", t);
+
+        // Picking starts from the drop position, where the arm is while the image is taken
+        std::vector<Detection> ordered = scheduler.order(found, SCARA::dropX, SCARA::dropY);
+        robot.getTracer().record("vision.schedule", t);
+        guard.lock();
+
+        if (ordered.empty()) {
+            // Nothing found or no answer, the arm is still out of view, try again
+            guard.unlock();
+            std::this_thread::sleep_for(EMPTY_RETRY);
+            guard.lock();
+            captureRequested = true;
+            continue;
+        }
+        targets.insert(targets.end(), ordered.begin(), ordered.end());
+        changed.notify_all();
+    }
+}
+
+/**
+ * Triggers the camera and waits for the answer to this trigger.
+ *
+ * @return The detected objects, empty on timeout or without connection
+ */
+std::vector<Detection> PickEngine::capture() {
+    const uint64_t trigger = hardware ? camera.expect(CycleScheduler::now()) : camera.trigger();
+    if (trigger == 0) {
+        std::cout << "Camera not connected" << std::endl;
+        return {};
+    }
+
+    // The result is expected before the pulse, it cannot arrive unmatched
+    CycleStamp pulse = {};
+    if (hardware && (hardware->fire() == 0 || !hardware->wait(pulse, PULSE_TIMEOUT))) {
+        // Otherwise the next result would be matched to this trigger
+        camera.cancel(trigger);
+        std::cout << "Hardware trigger not fired" << std::endl;
+        return {};
+    }
+
+    // The client reports a timeout, so this returns within its timeout
+    CameraEvent event;
+    while (camera.wait(event)) {
+        // Skip connection changes and results of earlier triggers
+        if (event.trigger != trigger) continue;
+        // The image was taken with the frame that carried the pulse
+        if (pulse.cycle != 0) event.triggered = pulse.sent;
+        latency.record(event);
+        if (event.type == CameraEvent::timeout) std::cout << "No result from the camera" << std::endl;
+        if (event.status != ResultParser::ok) std::cout << "Malformed camera result, status " << event.status << std::endl;
+        return event.detections;
+    }
+    return {};
+}
+
+/**
+ * Requests a capture from the vision thread.
+ */
+void PickEngine::requestCapture() {
+    std::lock_guard<std::mutex> guard(lock);
+    captureRequested = true;
+    changed.notify_all();
+}
+
+/**
+ * Requests a capture if no targets are left, the arm has to be out of view.
+ */
+void PickEngine::captureWhenEmpty() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (targets.empty()) {
+        captureRequested = true;
+        changed.notify_all();
+    }
+}
+
+/**
+ * Waits for the next target.
+ *
+ * @param target Set to the next target
+ *
+ * @return false if the engine was stopped
+ */
+bool PickEngine::nextTarget(Detection& target) {
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [this]() { return !targets.empty() || !running; });
+    if (!running) return false;
+    target = targets.front();
+    targets.pop_front();
+    return true;
+}
@@ -0,0 +1,63 @@
+// pickengine.h
+#ifndef PICKENGINE_H
+#define PICKENGINE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "scara.h"
+#include "cameraclient.h"
+#include "cameralatency.h"
+#include "hardwaretrigger.h"
+#include "pickscheduler.h"
+
+/**
+ * @brief Runs vision and motion of the pick cycle in parallel
+ *
+ * A vision thread triggers the camera and queues all objects found in the image
+ * in the order of the pick scheduler, a capture without result is retried. The
+ * next capture is requested once the queue is empty and the arm has moved out of
+ * the camera field of view on its way to the drop position, so the image is
+ * processed while the arm drops the object and the next pick can start right
+ * away.
+ */
+class PickEngine {
+    public:
+        PickEngine(SCARA& robot, CameraClient& camera, Master* master = nullptr, HardwareTrigger* hardware = nullptr);
+        ~PickEngine();
+
+        void run(uint64_t picks = 0); // Pick until stopped, or a number of objects
+        void stop();
+
+        uint64_t getPicks();
+        double picksPerMinute();
+        const CameraLatency& getCameraLatency() const;
+
+    private:
+        SCARA& robot;
+        CameraClient& camera; // Only read by the vision thread
+        CameraLatency latency; // Written by the vision thread
+        HardwareTrigger* hardware; // Triggers the camera instead of the TCP command, optional
+
+        std::mutex lock;
+        std::condition_variable changed; // Signals capture requests, new targets and stop
+        PickScheduler scheduler; // Only used by the vision thread
+        std::deque<Detection> targets;
+        bool captureRequested = false;
+        bool running = true;
+
+        std::atomic<uint64_t> picks{0};
+        std::chrono::steady_clock::time_point started;
+        std::thread vision_thread;
+
+        void vision(); // Capture and receive loop of the vision thread
+        std::vector<Detection> capture();
+        void requestCapture();
+        void captureWhenEmpty();
+        bool nextTarget(Detection& target);
+};
+
+#endif // PICKENGINE_H
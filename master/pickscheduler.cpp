@@ -0,0 +1,213 @@
+// pickscheduler.cpp
+#include "pickscheduler.h"
+
+#include <algorithm>
+
+/**
+ * Constructor for the pick scheduler.
+ *
+ * @param robot The robot, used for the inverse kinematics
+ * @param viaDrop True if the arm returns to the drop position between two picks
+ */
+PickScheduler::PickScheduler(SCARA& robot, bool viaDrop) : robot(robot), viaDrop(viaDrop) {
+    j1limits = SCARA::limitsFor(SCARA::j1speed);
+    j2limits = SCARA::limitsFor(SCARA::j2speed);
+}
+
+/**
+ * Orders the objects for picking.
+ *
+ * @param objects The objects found in one image
+ * @param startX The x coordinate of the arm when picking starts
+ * @param startY The y coordinate of the arm when picking starts
+ *
+ * @return The reachable objects in pick order
+ */
+std::vector<Detection> PickScheduler::order(const std::vector<Detection>& objects, double startX, double startY) {
+    // Pose 0 is the start, the objects follow
+    std::vector<float> x = {(float)startX};
+    std::vector<float> y = {(float)startY};
+    std::vector<float> angle = {0};
+    std::vector<Detection> candidates;
+    const WorkspaceGrid& workspace = robot.getWorkspace();
+    for (const Detection& object : objects) {
+        // Cheap rejection before the inverse kinematics, pickUp selects the elbow itself
+        if (!workspace.empty() && !workspace.reachable(object.x, object.y)) {
+            std::cerr << "Object at " << object.x << ", " << object.y << " out of reach" << std::endl;
+            continue;
+        }
+        candidates.push_back(object);
+        x.push_back((float)object.x);
+        y.push_back((float)object.y);
+        angle.push_back((float)object.angle);
+    }
+    ik::Batch solutions;
+    robot.calculateJointAngles(x.data(), y.data(), angle.data(), x.size(), solutions);
+
+    // The start and the drop are assumed in the configuration the workspace prefers
+    const JointAngles drop = viaDrop ? robot.calculateJointAngles(SCARA::dropX, SCARA::dropY, SCARA::dropAngle, preferLeft(SCARA::dropX, SCARA::dropY)) : JointAngles{};
+
+    std::vector<JointAngles> poses;
+    std::vector<Detection> reachable;
+    for (size_t i = 0; i < solutions.size(); i++) {
+        const bool left = allowed(solutions, i, x[i], y[i], true);
+        const bool right = allowed(solutions, i, x[i], y[i], false);
+        if (!left && !right) {
+            std::cerr << "Object at " << x[i] << ", " << y[i] << " out of reach" << std::endl;
+            if (i == 0) return {};
+            continue;
+        }
+        const JointAngles leftPose = {solutions.j1Left[i], solutions.j2Left[i], solutions.gripperLeft[i]};
+        const JointAngles rightPose = {solutions.j1Right[i], solutions.j2Right[i], solutions.gripperRight[i]};
+
+        // Like selectElbow in pickUp, the configuration reached first from where the pick starts
+        bool useLeft = left;
+        if (left && right) {
+            if (i == 0) {
+                useLeft = preferLeft(x[i], y[i]);
+            } else {
+                const JointAngles& from = viaDrop ? drop : poses[0];
+                const double toLeft = travel(from, leftPose);
+                const double toRight = travel(from, rightPose);
+                useLeft = toLeft == toRight ? preferLeft(x[i], y[i]) : toLeft < toRight;
+            }
+        }
+        poses.push_back(useLeft ? leftPose : rightPose);
+        if (i > 0) reachable.push_back(candidates[i - 1]);
+    }
+
+    const size_t n = poses.size();
+    if (n <= 2) {
+        travelTime = n == 2 ? travel(poses[0], poses[1]) : 0;
+        return reachable;
+    }
+
+    if (viaDrop) {
+        // Every pick goes drop, object, drop, so the sum of the moves is the same in
+        // any order except for two of them: the first object is reached from the start
+        // instead of the drop, and the way of the last object back to the drop runs
+        // while the next image is taken. No tour search needed, the object that gains
+        // most from the start goes first and the one farthest from the drop last.
+        std::vector<double> out(n, 0);
+        std::vector<double> back(n, 0);
+        size_t last = 1;
+        for (size_t b = 1; b < n; b++) {
+            out[b] = travel(drop, poses[b]);
+            back[b] = travel(poses[b], drop);
+            if (back[b] > back[last]) last = b;
+        }
+        size_t first = 0;
+        double firstGain = 0;
+        for (size_t b = 1; b < n; b++) {
+            if (b == last) continue;
+            const double gain = travel(poses[0], poses[b]) - out[b];
+            if (first == 0 || gain < firstGain) {
+                first = b;
+                firstGain = gain;
+            }
+        }
+
+        std::vector<Detection> result = {reachable[first - 1]};
+        travelTime = travel(poses[0], poses[first]) + back[first];
+        for (size_t b = 1; b < n; b++) {
+            if (b == first || b == last) continue;
+            result.push_back(reachable[b - 1]);
+            travelTime += out[b] + back[b];
+        }
+        result.push_back(reachable[last - 1]);
+        travelTime += out[last];
+        return result;
+    }
+
+    // Travel time between every pair of poses
+    std::vector<std::vector<double>> cost(n, std::vector<double>(n, 0));
+    for (size_t a = 0; a < n; a++) {
+        for (size_t b = 0; b < n; b++) {
+            if (a != b) cost[a][b] = travel(poses[a], poses[b]);
+        }
+    }
+
+    // Nearest neighbour tour from the start
+    std::vector<size_t> tour = {0};
+    std::vector<bool> visited(n, false);
+    visited[0] = true;
+    for (size_t step = 1; step < n; step++) {
+        size_t best = 0;
+        for (size_t b = 1; b < n; b++) {
+            if (!visited[b] && (best == 0 || cost[tour.back()][b] < cost[tour.back()][best])) best = b;
+        }
+        visited[best] = true;
+        tour.push_back(best);
+    }
+
+    // 2-opt on the open tour, the start stays in front
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        for (size_t i = 1; i + 1 < n; i++) {
+            for (size_t k = i + 1; k < n; k++) {
+                double before = cost[tour[i - 1]][tour[i]];
+                double after = cost[tour[i - 1]][tour[k]];
+                if (k + 1 < n) {
+                    before += cost[tour[k]][tour[k + 1]];
+                    after += cost[tour[i]][tour[k + 1]];
+                }
+                if (after < before - 1e-9) {
+                    std::reverse(tour.begin() + i, tour.begin() + k + 1);
+                    improved = true;
+                }
+            }
+        }
+    }
+
+    std::vector<Detection> result;
+    travelTime = 0;
+    for (size_t i = 1; i < n; i++) {
+        result.push_back(reachable[tour[i] - 1]);
+        travelTime += cost[tour[i - 1]][tour[i]];
+    }
+    return result;
+}
+
+/**
+ * @return Travel time in s of the order returned last
+ */
+double PickScheduler::getTravelTime() {
+    return travelTime;
+}
+
+/**
+ * Checks one elbow configuration of a solution against the joint ranges of the workspace.
+ *
+ * @return true if the arm can take the position in this configuration
+ */
+bool PickScheduler::allowed(const ik::Batch& solutions, size_t i, float x, float y, bool elbowLeft) {
+    if (!solutions.reachable[i]) return false;
+    const WorkspaceGrid& workspace = robot.getWorkspace();
+    return workspace.empty() || workspace.reachable(x, y, elbowLeft);
+}
+
+/**
+ * @return true if the elbow left configuration is the better one for a position, right without a workspace
+ */
+bool PickScheduler::preferLeft(double x, double y) {
+    const WorkspaceGrid& workspace = robot.getWorkspace();
+    return !workspace.empty() && workspace.preferLeft(x, y);
+}
+
+/**
+ * Time of a synchronised J1/J2 move.
+ *
+ * @param from The joint angles at the start
+ * @param to The joint angles at the end
+ *
+ * @return Time in s, the longer of both joints
+ */
+double PickScheduler::travel(const JointAngles& from, const JointAngles& to) {
+    // Limits are in drive increments
+    const units::Millidegrees j1distance = units::Degrees(to.j1 - from.j1);
+    const units::Millidegrees j2distance = units::Degrees(to.j2 - from.j2);
+    const double j1 = DoubleS(j1distance.value(), j1limits).duration();
+    const double j2 = DoubleS(j2distance.value(), j2limits).duration();
+    return std::max(j1, j2);
+}
@@ -0,0 +1,38 @@
+// pickscheduler.h
+#ifndef PICKSCHEDULER_H
+#define PICKSCHEDULER_H
+
+#include <vector>
+#include "scara.h"
+#include "camera.h"
+
+/**
+ * @brief Orders the objects of one image to keep the joint travel time short
+ *
+ * The cost between two poses is the time of the synchronised J1/J2 move between
+ * them. When every object is brought to the drop position the order only decides
+ * which object comes first and which last. Otherwise a nearest neighbour tour is
+ * improved with 2-opt until no exchange of two edges shortens it. Every object is
+ * planned with the elbow configuration pickUp selects, objects out of reach of
+ * both are left out.
+ */
+class PickScheduler {
+    public:
+        PickScheduler(SCARA& robot, bool viaDrop = true);
+
+        std::vector<Detection> order(const std::vector<Detection>& objects, double startX, double startY);
+        double getTravelTime(); // Travel time in s of the last order
+
+    private:
+        SCARA& robot;
+        bool viaDrop; // Every object is brought to the drop position before the next pick
+        JointLimits j1limits;
+        JointLimits j2limits;
+        double travelTime = 0;
+
+        double travel(const JointAngles& from, const JointAngles& to);
+        bool allowed(const ik::Batch& solutions, size_t i, float x, float y, bool elbowLeft);
+        bool preferLeft(double x, double y);
+};
+
+#endif // PICKSCHEDULER_H
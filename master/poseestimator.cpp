@@ -0,0 +1,104 @@
+// poseestimator.cpp
+#include "poseestimator.h"
+
+#include <chrono>
+#include <cmath>
+
+/**
+ * Constructor that starts estimating in the next cycle
+ *
+ * @param master EtherCAT master running the cycle
+ * @param robot Robot with the forward kinematics
+ * @param firstSlave Slave number of Joint 1, Joint 2 to 4 are the following slaves
+ */
+PoseEstimator::PoseEstimator(Master& master, SCARA& robot, int firstSlave) : master(master), robot(robot), firstSlave(firstSlave) {
+    hook = master.addCycleHook([this]() { update(); });
+}
+
+/**
+ * Destructor that stops estimating
+ *
+ * @note Nobody may wait in waitWithin anymore
+ */
+PoseEstimator::~PoseEstimator(){
+    master.removeCycleHook(hook);
+}
+
+/**
+ * Calculate and publish the pose from the inputs of this cycle
+ */
+void PoseEstimator::update(){
+    const units::Degrees j1 = SCARA::J1Axis::fromIncrements(master.getPos(firstSlave));
+    const units::Degrees j2 = SCARA::J2Axis::fromIncrements(master.getPos(firstSlave + 1));
+    const units::Millimetres j3 = SCARA::J3Axis::fromIncrements(master.getPos(firstSlave + 2));
+    const units::Degrees j4 = SCARA::J4Axis::fromIncrements(master.getPos(firstSlave + 3));
+    const Pose next = robot.calculatePose(j1.value(), j2.value(), j3.value(), j4.value());
+    seq.writeBegin();
+    pose = next;
+    seq.writeEnd();
+    updates.fetch_add(1, std::memory_order_release);
+
+    if (waiters.load() > 0){
+        // Only tried, a waiter holds the mutex while it checks and is notified by the next cycle then
+        std::unique_lock<std::mutex> lock(waitMutex, std::try_to_lock);
+        if (!lock.owns_lock()) return;
+        lock.unlock(); // Taken once so the notify comes after a waiter's check
+        updated.notify_all();
+    }
+}
+
+/**
+ * Get the pose of the gripper
+ *
+ * @return Pose calculated from the actual positions of the last cycle
+ */
+Pose PoseEstimator::get(){
+    Pose result;
+    uint32_t s;
+    do {
+        s = seq.readBegin();
+        result = pose;
+    } while (seq.readRetry(s));
+    return result;
+}
+
+/**
+ * @return Number of cycles the pose was updated in
+ */
+uint64_t PoseEstimator::getUpdates(){
+    return updates.load(std::memory_order_acquire);
+}
+
+/**
+ * Wait until the gripper is close to a pose
+ *
+ * Returns as soon as the distance is within the tolerance, the drives may still
+ * be settling and have not signalled motion complete yet.
+ *
+ * @param target Pose to reach, the angle is not compared
+ * @param tolerance Distance in mm
+ * @param timeout Timeout in ms, 0 waits forever
+ *
+ * @return true if the pose was reached, false on timeout
+ */
+bool PoseEstimator::waitWithin(const Pose& target, double tolerance, uint32_t timeout){
+    auto within = [&]() {
+        const Pose now = get();
+        const double dx = now.x - target.x;
+        const double dy = now.y - target.y;
+        const double dz = now.z - target.z;
+        return dx * dx + dy * dy + dz * dz <= tolerance * tolerance;
+    };
+
+    waiters.fetch_add(1, std::memory_order_acq_rel);
+    std::unique_lock<std::mutex> lock(waitMutex);
+    bool reached;
+    if (timeout == 0) {
+        updated.wait(lock, within);
+        reached = true;
+    } else {
+        reached = updated.wait_for(lock, std::chrono::milliseconds(timeout), within);
+    }
+    waiters.fetch_sub(1, std::memory_order_acq_rel);
+    return reached;
+}
@@ -0,0 +1,45 @@
+// poseestimator.h
+#ifndef POSEESTIMATOR_H
+#define POSEESTIMATOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include "master.h"
+#include "seqlock.h"
+#include "scara.h"
+
+/**
+ * @brief Live Cartesian pose of the gripper, updated every cycle
+ *
+ * The cycle thread reads Position_Actual_Value of the four joints, runs the
+ * forward kinematics and publishes the result behind a sequence lock, so
+ * readers never block the cycle and the cycle never blocks readers.
+ */
+class PoseEstimator {
+    public:
+        PoseEstimator(Master& master, SCARA& robot, int firstSlave = 1);
+        ~PoseEstimator();
+
+        Pose get(); // Pose of the last cycle
+        uint64_t getUpdates(); // Number of cycles the pose was updated in
+        bool waitWithin(const Pose& target, double tolerance, uint32_t timeout = 0);
+
+    private:
+        Master& master;
+        SCARA& robot;
+        int firstSlave; // Slave of Joint 1, the other joints follow
+        int hook;       // Id of the cycle hook
+
+        SeqLock seq;
+        Pose pose = {};
+        std::atomic<uint64_t> updates{0};
+
+        std::mutex waitMutex; // Only guards the wake-up of waiters
+        std::condition_variable updated;
+        std::atomic<int> waiters{0};
+
+        void update(); // Called by the cycle thread
+};
+
+#endif // POSEESTIMATOR_H
@@ -0,0 +1,189 @@
+// processimage.cpp
+#include "processimage.h"
+
+#include <cstring>
+
+/**
+ * Constructor for the process image, all data starts zeroed like the IOmap
+ */
+ProcessImage::ProcessImage(){
+    memset(staged, 0, sizeof(staged));
+    memset(pending, 0, sizeof(pending));
+    memset(snapshot, 0, sizeof(snapshot));
+    memset(overlaid, 0, sizeof(overlaid));
+    memset(overlaidMask, 0, sizeof(overlaidMask));
+}
+
+/**
+ * Stage output data for the next cycle
+ *
+ * @param offset Byte offset in the IOmap
+ * @param value Data to write
+ * @param size Number of bytes
+ */
+void ProcessImage::write(uint32_t offset, const void* value, uint32_t size){
+    if (offset + size > PROCESS_IMAGE_SIZE) return;
+    lockWriter();
+    stagedSeq.writeBegin();
+    memcpy(staged + offset, value, size);
+    stagedSeq.writeEnd();
+    unlockWriter();
+}
+
+/**
+ * Set and clear bits of a staged output byte in one step
+ *
+ * @param offset Byte offset in the IOmap
+ * @param set Bits to set
+ * @param clear Bits to clear
+ *
+ * @return New value of the byte
+ */
+uint8_t ProcessImage::modify(uint32_t offset, uint8_t set, uint8_t clear){
+    if (offset >= PROCESS_IMAGE_SIZE) return 0;
+    lockWriter();
+    stagedSeq.writeBegin();
+    const uint8_t value = (staged[offset] & ~clear) | set;
+    staged[offset] = value;
+    stagedSeq.writeEnd();
+    unlockWriter();
+    return value;
+}
+
+/**
+ * Zero a range of staged outputs
+ *
+ * @param offset Byte offset in the IOmap
+ * @param size Number of bytes
+ */
+void ProcessImage::clear(uint32_t offset, uint32_t size){
+    if (offset + size > PROCESS_IMAGE_SIZE) return;
+    lockWriter();
+    stagedSeq.writeBegin();
+    memset(staged + offset, 0, size);
+    stagedSeq.writeEnd();
+    unlockWriter();
+}
+
+/**
+ * Read from the input snapshot of the last cycle
+ *
+ * @param offset Byte offset in the IOmap
+ * @param value Buffer to copy the data into
+ * @param size Number of bytes
+ *
+ * @note Only retries while the cycle thread is copying a new snapshot, never waits on the bus
+ */
+void ProcessImage::read(uint32_t offset, void* value, uint32_t size) const {
+    if (offset + size > PROCESS_IMAGE_SIZE) return;
+    uint32_t seq;
+    do {
+        seq = snapshotSeq.readBegin();
+        memcpy(value, snapshot + offset, size);
+    } while (snapshotSeq.readRetry(seq));
+}
+
+/**
+ * Read a single byte from the input snapshot
+ *
+ * @param offset Byte offset in the IOmap
+ *
+ * @return Byte value
+ */
+uint8_t ProcessImage::readByte(uint32_t offset) const {
+    uint8_t value = 0;
+    read(offset, &value, sizeof(value));
+    return value;
+}
+
+/**
+ * Copy the staged outputs into the IOmap, called by the cycle thread before sending
+ *
+ * If an application thread is writing at this moment the IOmap keeps the outputs of
+ * the previous cycle, the staged data goes out one cycle later. The outputs of the
+ * cycle thread go out in any case.
+ *
+ * @param iomap IOmap used by SOEM
+ * @param offset Start of the output area in the IOmap
+ * @param size Size of the output area
+ *
+ * @return true if new outputs were published
+ */
+bool ProcessImage::publish(uint8_t* iomap, uint32_t offset, uint32_t size){
+    if (offset + size > PROCESS_IMAGE_SIZE) return false;
+    bool published = false;
+    uint32_t seq;
+    if (stagedSeq.tryReadBegin(seq)) {
+        memcpy(pending + offset, staged + offset, size);
+        if (!stagedSeq.readRetry(seq)) {
+            memcpy(iomap + offset, pending + offset, size);
+            published = true;
+        }
+    }
+    applyOverlay(iomap);
+    mergeOverlay();
+    return published;
+}
+
+/**
+ * Write output bits from the cycle thread
+ *
+ * The bits win over application writes to the same bits staged before the
+ * next publish. Bits outside the mask keep their staged value.
+ *
+ * @param offset Byte offset in the IOmap
+ * @param value Data to write
+ * @param mask Bits of the data to write
+ * @param size Number of bytes
+ */
+void ProcessImage::overlay(uint32_t offset, const void* value, const void* mask, uint32_t size){
+    if (offset + size > PROCESS_IMAGE_SIZE) return;
+    const uint8_t* bytes = (const uint8_t*)value;
+    const uint8_t* bits = (const uint8_t*)mask;
+    for (uint32_t i = 0; i < size; i++) {
+        overlaid[offset + i] = (overlaid[offset + i] & ~bits[i]) | (bytes[i] & bits[i]);
+        overlaidMask[offset + i] |= bits[i];
+    }
+    if (offset < overlayBegin) overlayBegin = offset;
+    if (offset + size > overlayEnd) overlayEnd = offset + size;
+}
+
+/**
+ * Put the outputs of the cycle thread on top of an output image
+ */
+void ProcessImage::applyOverlay(uint8_t* target){
+    for (uint32_t i = overlayBegin; i < overlayEnd; i++) {
+        target[i] = (target[i] & ~overlaidMask[i]) | (overlaid[i] & overlaidMask[i]);
+    }
+}
+
+/**
+ * Move the outputs of the cycle thread into the staging buffer
+ *
+ * @note Only tries the writer lock, while an application thread writes the overlay is kept for the next cycle
+ */
+void ProcessImage::mergeOverlay(){
+    if (overlayBegin >= overlayEnd) return;
+    if (writerLock.test_and_set(std::memory_order_acquire)) return;
+    stagedSeq.writeBegin();
+    applyOverlay(staged);
+    stagedSeq.writeEnd();
+    unlockWriter();
+    memset(overlaidMask + overlayBegin, 0, overlayEnd - overlayBegin);
+    overlayBegin = PROCESS_IMAGE_SIZE;
+    overlayEnd = 0;
+}
+
+/**
+ * Copy the received inputs into the snapshot, called by the cycle thread after receiving
+ *
+ * @param iomap IOmap used by SOEM
+ * @param offset Start of the input area in the IOmap
+ * @param size Size of the input area
+ */
+void ProcessImage::capture(const uint8_t* iomap, uint32_t offset, uint32_t size){
+    if (offset + size > PROCESS_IMAGE_SIZE) return;
+    snapshotSeq.writeBegin();
+    memcpy(snapshot + offset, iomap + offset, size);
+    snapshotSeq.writeEnd();
+}
@@ -0,0 +1,161 @@
+// processimage.h
+#ifndef PROCESSIMAGE_H
+#define PROCESSIMAGE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include "seqlock.h"
+
+constexpr uint32_t PROCESS_IMAGE_SIZE = 4096;
+
+/**
+ * @brief Double buffered copy of the EtherCAT IOmap
+ *
+ * Application threads write outputs into a staging buffer and read inputs from a
+ * snapshot. The cycle thread publishes the staged outputs into the IOmap right
+ * before sending and captures the inputs right after receiving. Neither side holds
+ * a lock while a frame is on the wire.
+ *
+ * Outputs the cycle thread writes itself go into an overlay of its own instead
+ * of the staging buffer, so it never waits for an application writer. The
+ * overlay is applied on top of the staged outputs when publishing and merged
+ * into the staging buffer once no application thread is writing.
+ *
+ * All offsets are byte offsets into the IOmap.
+ */
+class ProcessImage {
+    public:
+        ProcessImage();
+
+        // Application side
+        void write(uint32_t offset, const void* value, uint32_t size);
+        uint8_t modify(uint32_t offset, uint8_t set, uint8_t clear);
+        void clear(uint32_t offset, uint32_t size);
+        void read(uint32_t offset, void* value, uint32_t size) const;
+        uint8_t readByte(uint32_t offset) const;
+
+        template<typename T> void store(uint32_t offset, T value);
+        template<typename T> T modifyBits(uint32_t offset, T set, T clear);
+        template<typename T> T load(uint32_t offset) const;
+
+        // Cycle thread side
+        bool publish(uint8_t* iomap, uint32_t offset, uint32_t size);
+        void capture(const uint8_t* iomap, uint32_t offset, uint32_t size);
+        void overlay(uint32_t offset, const void* value, const void* mask, uint32_t size);
+
+        template<typename T> void overlayStore(uint32_t offset, T value);
+        template<typename T> void overlayBits(uint32_t offset, T set, T clear);
+
+    private:
+        alignas(8) uint8_t staged[PROCESS_IMAGE_SIZE];   // Outputs written by the application
+        alignas(8) uint8_t pending[PROCESS_IMAGE_SIZE];  // Consistent copy of the staged outputs taken by the cycle thread
+        alignas(8) uint8_t snapshot[PROCESS_IMAGE_SIZE]; // Inputs of the last received frame
+        alignas(8) uint8_t overlaid[PROCESS_IMAGE_SIZE]; // Outputs written by the cycle thread, cycle thread only
+        alignas(8) uint8_t overlaidMask[PROCESS_IMAGE_SIZE]; // Bits of overlaid not merged into staged yet
+        uint32_t overlayBegin = PROCESS_IMAGE_SIZE; // Range of overlaidMask with bits set
+        uint32_t overlayEnd = 0;
+
+        SeqLock stagedSeq;
+        SeqLock snapshotSeq;
+        std::atomic_flag writerLock = ATOMIC_FLAG_INIT; // Serialises application writers, only tried by the cycle thread
+
+        void lockWriter(){
+            while (writerLock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+        }
+        void unlockWriter(){
+            writerLock.clear(std::memory_order_release);
+        }
+        void applyOverlay(uint8_t* target);
+        void mergeOverlay();
+};
+
+/**
+ * Stage a value for the next cycle
+ *
+ * Inline so a fixed size object compiles to a single store.
+ *
+ * @param offset Byte offset in the IOmap
+ * @param value Value to write, process data is little endian like the host
+ */
+template<typename T>
+inline void ProcessImage::store(uint32_t offset, T value){
+    if (offset + sizeof(T) > PROCESS_IMAGE_SIZE) return;
+    lockWriter();
+    stagedSeq.writeBegin();
+    memcpy(staged + offset, &value, sizeof(T));
+    stagedSeq.writeEnd();
+    unlockWriter();
+}
+
+/**
+ * Set and clear bits of a staged output in one step
+ *
+ * @param offset Byte offset in the IOmap
+ * @param set Bits to set
+ * @param clear Bits to clear
+ *
+ * @return New value of the output
+ */
+template<typename T>
+inline T ProcessImage::modifyBits(uint32_t offset, T set, T clear){
+    if (offset + sizeof(T) > PROCESS_IMAGE_SIZE) return T();
+    lockWriter();
+    stagedSeq.writeBegin();
+    T value;
+    memcpy(&value, staged + offset, sizeof(T));
+    value = (T)((value & ~clear) | set);
+    memcpy(staged + offset, &value, sizeof(T));
+    stagedSeq.writeEnd();
+    unlockWriter();
+    return value;
+}
+
+/**
+ * Write a value from the cycle thread, it goes out with the next frame
+ *
+ * @param offset Byte offset in the IOmap
+ * @param value Value to write, process data is little endian like the host
+ */
+template<typename T>
+inline void ProcessImage::overlayStore(uint32_t offset, T value){
+    const T mask = (T)~T();
+    overlay(offset, &value, &mask, sizeof(T));
+}
+
+/**
+ * Set and clear bits of an output from the cycle thread, they go out with the next frame
+ *
+ * @param offset Byte offset in the IOmap
+ * @param set Bits to set
+ * @param clear Bits to clear
+ */
+template<typename T>
+inline void ProcessImage::overlayBits(uint32_t offset, T set, T clear){
+    const T mask = (T)(set | clear);
+    overlay(offset, &set, &mask, sizeof(T));
+}
+
+/**
+ * Read a value from the input snapshot of the last cycle
+ *
+ * Inline so a fixed size object compiles to a single load.
+ *
+ * @param offset Byte offset in the IOmap
+ *
+ * @return Value, process data is little endian like the host
+ */
+template<typename T>
+inline T ProcessImage::load(uint32_t offset) const {
+    T value = T();
+    if (offset + sizeof(T) > PROCESS_IMAGE_SIZE) return value;
+    uint32_t seq;
+    do {
+        seq = snapshotSeq.readBegin();
+        memcpy(&value, snapshot + offset, sizeof(T));
+    } while (snapshotSeq.readRetry(seq));
+    return value;
+}
+
+#endif // PROCESSIMAGE_H
@@ -0,0 +1,175 @@
+// resultparser.cpp
+#include "resultparser.h"
+
+#include <charconv>
+#include <cstring>
+
+/**
+ * Constructor for a parser at the start of the stream
+ */
+ResultParser::ResultParser() : used(0), overflow(false), errors(0) {}
+
+/**
+ * Parse the bytes of one read
+ *
+ * @param data Bytes as received
+ * @param size Number of bytes
+ * @param handler Called for every message completed by these bytes
+ *
+ * @return Number of messages completed
+ */
+size_t ResultParser::feed(const char* data, size_t size, const handler_t& handler){
+    const char* end = data + size;
+    size_t messages = 0;
+    while (data < end) {
+        const char* stop = data;
+        while (stop < end && *stop != '\n' && *stop != '\0') stop++;
+        if (stop == end) {
+            append(data, end);
+            break;
+        }
+
+        if (used == 0 && !overflow) {
+            // A delimiter right after another, like a null after the line feed, ends no message
+            if (stop == data) {
+                data = stop + 1;
+                continue;
+            }
+            // The whole message is in this read, no copy
+            complete(data, stop, handler);
+        } else {
+            append(data, stop);
+            completePartial(handler);
+        }
+        messages++;
+        data = stop + 1;
+    }
+    return messages;
+}
+
+/**
+ * Take the bytes received so far as complete message
+ *
+ * For a sender that does not terminate its messages.
+ *
+ * @return 1 if there was a message, 0 otherwise
+ */
+size_t ResultParser::flush(const handler_t& handler){
+    if (!pending()) return 0;
+    completePartial(handler);
+    return 1;
+}
+
+/**
+ * @return true if part of a message was received
+ */
+bool ResultParser::pending() const {
+    return used > 0 || overflow;
+}
+
+/**
+ * Drop a partly received message, after a reconnect
+ */
+void ResultParser::reset(){
+    used = 0;
+    overflow = false;
+}
+
+/**
+ * @return Number of messages with a status other than ok
+ */
+uint64_t ResultParser::getErrors() const {
+    return errors;
+}
+
+/**
+ * Parse one message in place
+ *
+ * Values without any digit are skipped, they are the terminator and line
+ * endings the camera appends.
+ *
+ * @param begin First byte of the message
+ * @param end End of the message, without the delimiter
+ * @param out Objects found, in mm and degrees
+ * @param capacity Size of out
+ * @param count Set to the number of objects in out
+ *
+ * @return Status of the message
+ */
+ResultParser::status_t ResultParser::parse(const char* begin, const char* end, Detection* out, size_t capacity, size_t& count){
+    status_t status = ok;
+    double values[3];
+    int filled = 0;
+    count = 0;
+
+    while (begin < end) {
+        const char* stop = (const char*)std::memchr(begin, ';', end - begin);
+        if (stop == nullptr) stop = end;
+
+        const char* first = begin;
+        const char* last = stop;
+        begin = stop + 1;
+        while (first < last && (*first == ' ' || *first == '\t' || *first == '\r')) first++;
+        while (last > first && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r')) last--;
+
+        bool digits = false;
+        for (const char* c = first; c < last && !digits; c++) digits = *c >= '0' && *c <= '9';
+        if (!digits) continue;
+
+        // from_chars does not take a plus sign
+        if (*first == '+') first++;
+        double value;
+        const std::from_chars_result read = std::from_chars(first, last, value);
+        if (read.ec != std::errc() || read.ptr != last) {
+            count = 0;
+            return bad_number;
+        }
+
+        values[filled++] = value / 1000.0;
+        if (filled == 3) {
+            if (count < capacity) out[count++] = {values[0], values[1], values[2]};
+            else status = too_many_objects;
+            filled = 0;
+        }
+    }
+    if (filled != 0 && status == ok) status = incomplete_object;
+    return status;
+}
+
+/**
+ * Keep bytes of an unterminated message
+ */
+void ResultParser::append(const char* begin, const char* end){
+    const size_t size = end - begin;
+    if (overflow) return;
+    if (used + size > MAX_MESSAGE) {
+        overflow = true;
+        used = 0;
+        return;
+    }
+    std::memcpy(partial + used, begin, size);
+    used += size;
+}
+
+/**
+ * Parse a message and hand it over
+ */
+void ResultParser::complete(const char* begin, const char* end, const handler_t& handler){
+    Message message = {ok, detections, 0, begin, (size_t)(end - begin)};
+    message.status = parse(begin, end, detections, MAX_OBJECTS, message.count);
+    if (message.status != ok) errors++;
+    handler(message);
+}
+
+/**
+ * Parse the kept bytes as message and start over
+ */
+void ResultParser::completePartial(const handler_t& handler){
+    if (overflow) {
+        errors++;
+        handler(Message{too_long, detections, 0, nullptr, 0});
+    } else {
+        complete(partial, partial + used, handler);
+    }
+    reset();
+}
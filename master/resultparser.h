@@ -0,0 +1,65 @@
+// resultparser.h
+#ifndef RESULTPARSER_H
+#define RESULTPARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "camera.h"
+
+/**
+ * @brief Splits the camera result stream into messages and parses them in place
+ *
+ * Bytes are fed as they arrive, a read may hold part of a message or several
+ * messages. A message ends with a line feed or a null byte, consecutive
+ * delimiters end one message. It holds groups of x, y and angle separated by
+ * semicolons, in thousandths like parseDetections of Camera. Messages that lie
+ * within one read are parsed where they are, only the unterminated rest of a
+ * read is copied. Numbers are read with from_chars, nothing is allocated and
+ * nothing is thrown, problems are reported as status.
+ */
+class ResultParser {
+    public:
+        static constexpr size_t MAX_MESSAGE = 4096; // Longest message kept across reads
+        static constexpr size_t MAX_OBJECTS = 256;  // Objects kept per message
+
+        typedef enum {
+            ok,
+            bad_number,        // A value is not a number, no objects are kept
+            incomplete_object, // The values do not fill the last object, the complete ones are kept
+            too_many_objects,  // More than MAX_OBJECTS, the first ones are kept
+            too_long,          // Longer than MAX_MESSAGE, no objects are kept
+        }status_t;
+
+        struct Message {
+            status_t status;
+            const Detection* detections; // Only valid while the handler runs
+            size_t count;
+            const char* text; // Message without its delimiter, only valid while the handler runs
+            size_t length;
+        };
+        typedef std::function<void(const Message&)> handler_t;
+
+        ResultParser();
+
+        size_t feed(const char* data, size_t size, const handler_t& handler);
+        size_t flush(const handler_t& handler); // Complete an unterminated message
+        bool pending() const;
+        void reset();
+        uint64_t getErrors() const; // Messages with a status other than ok
+
+        static status_t parse(const char* begin, const char* end, Detection* out, size_t capacity, size_t& count);
+
+    private:
+        char partial[MAX_MESSAGE]; // Unterminated message of the previous reads
+        size_t used;
+        bool overflow; // Skipping a message that did not fit
+        Detection detections[MAX_OBJECTS];
+        uint64_t errors;
+
+        void append(const char* begin, const char* end);
+        void complete(const char* begin, const char* end, const handler_t& handler);
+        void completePartial(const handler_t& handler);
+};
+
+#endif // RESULTPARSER_H
@@ -1,7 +1,14 @@
 // scara.cpp
 #include "scara.h"
+#include "poseestimator.h"
 
 const double PI = 3.14159265358979323846;
+const double RAMP_TIME = 0.2; // Assumed time in s the drives need to reach full velocity
+const double PICK_TOLERANCE = 2.0; // Distance in mm to the pick position at which the vacuum is started
+const uint32_t PICK_TIMEOUT = 3000; // Time in ms to wait for the pick position
+const uint32_t AIR_PRESSURE_OUTPUT = 1 << 16; // Valve on the digital outputs of the air pressure slave
+const uint32_t VACUUM_INPUT = 1 << 13; // Vacuum switch in 0x213D:01, the bit that differs between 12603140 and 12611332
+const uint32_t VACUUM_TIMEOUT = 1500; // Time in ms to wait for the vacuum
 
 /**
  * Constructor for SCARA.
@@ -12,7 +19,7 @@ const double PI = 3.14159265358979323846;
  * @param airPressureSlave The index of the slave that controls the air pressure
  * 
 */
-SCARA::SCARA(double length_a1, double length_a2, std::vector<Slave>& ecSlavesVec, int airPressureSlave) : a1(length_a1), a2(length_a2), ecSlaves(ecSlavesVec), apSlave(airPressureSlave) {
+SCARA::SCARA(double length_a1, double length_a2, std::vector<Slave>& ecSlavesVec, int airPressureSlave) : a1(length_a1), a2(length_a2), ecSlaves(ecSlavesVec), apSlave(airPressureSlave), vacuum(VACUUM_INPUT, VACUUM_TIMEOUT) {
     initSlaves();
 
     // Set the bitmask for the air pressure slave
@@ -56,42 +63,157 @@ JointAngles SCARA::calculateJointAngles(double x, double y, double angle, bool e
     result.j2 = j2 * 180.0 / PI; // Convert J2 to degrees
 
     result.gripper_angle = result.j1 + result.j2 - angle;
-    //print gripper angle and j1 and j2
-    std::cout << "gripper angle: " << result.gripper_angle << std::endl;
-    std::cout << "j1: " << result.j1 << std::endl;
-    std::cout << "j2: " << result.j2 << std::endl;
 
     return result;
 }
 
 /**
- * Acknowledges faults and enables powerstage for all slaves.
+ * Reads the software position limits of a joint from its drive.
+ * 
+ * @param joint Index of Joint 1 or 2 in ecSlaves
  * 
+ * @return The range in degrees, -360 to 360 if the drive has no limits set
 */
-void SCARA::initSlaves() {
-    for (auto& ecSlave : this->ecSlaves) {
-        ecSlave.acknowledge_faults();
-        ecSlave.enable_powerstage();
-    } 
+JointRange SCARA::getJointRange(int joint) {
+    int32_t min = 0, max = 0;
+    int size = sizeof(min);
+    ecSlaves[joint].read_sdo(0x607D, 0x01, &min, &size);
+    size = sizeof(max);
+    ecSlaves[joint].read_sdo(0x607D, 0x02, &max, &size);
+
+    if (min >= max) {
+        return JointRange{-360.0f, 360.0f};
+    }
+    // Joint 1 and 2 share the same scaling
+    return JointRange{(float)units::Degrees(J1Axis::fromIncrements(min)).value(), (float)units::Degrees(J1Axis::fromIncrements(max)).value()};
 }
 
 /**
- * Moves a slave to a position.
+ * Compares the position unit of every joint drive with the scaling of its axis type.
+ * 
+ * The unit is read from the SI unit position (0x60A8), which follows the
+ * fieldbus factors set in the drive.
  * 
- * @param ecSlave The slave to move
- * @param slaveNr The index of the slave in the ecSlaves vector
- * @param position The position to move to
- * @param velocity The velocity to move with
+ * @return EXIT_SUCCESS, EXIT_FAILURE if a drive uses another unit
  * 
+ * @note A drive that does not report its unit is only warned about
 */
-void SCARA::moveToPos(Slave ecSlave, int slaveNr, int position, int velocity) {
-    // Ensure that slaveNr is a valid index (0 to size() - 1)
-    if (slaveNr >= 1 && slaveNr <= this->ecSlaves.size()) {
-        this->ecSlaves[slaveNr - 1].position_task(position, velocity, true, false);
-    } else {
-        // Handle error: slaveNr is out of range
-        std::cerr << "Error: Invalid slave number\n";
+int SCARA::checkScaling() {
+    const uint32_t expected[] = {J1Axis::siUnitPosition(), J2Axis::siUnitPosition(), J3Axis::siUnitPosition(), J4Axis::siUnitPosition()};
+    int result = EXIT_SUCCESS;
+    for (int joint = 0; joint < 4; joint++) {
+        uint32_t unit = 0;
+        int size = sizeof(unit);
+        ecSlaves[joint].read_sdo(0x60A8, 0x00, &unit, &size);
+        if (unit == 0) {
+            std::cout << "Warning: Position unit of joint " << joint + 1 << " not readable, scaling not checked" << std::endl;
+        } else if (unit != expected[joint]) {
+            std::cout << "Error: Joint " << joint + 1 << " uses position unit 0x" << std::hex << unit << " instead of 0x"
+                      << expected[joint] << std::dec << ", check the fieldbus factors of the drive" << std::endl;
+            result = EXIT_FAILURE;
+        }
+    }
+    return result;
+}
+
+/**
+ * Loads the workspace grid, it is built and saved first if the file does not match.
+ * 
+ * @param path The file the grid is kept in
+ * 
+ * @return EXIT_SUCCESS or EXIT_FAILURE if the grid could not be saved
+ * 
+ * @note The ranges of Joint 1 and 2 are taken from the drives
+*/
+int SCARA::loadWorkspace(const std::string& path) {
+    int result = this->workspace.loadOrBuild(path, (float)a1, (float)a2, getJointRange(0), getJointRange(1));
+
+    for (bool elbowLeft : {false, true}) {
+        if (!this->workspace.reachable(dropX, dropY, elbowLeft)) {
+            std::cout << "Warning: Drop position out of reach with the elbow " << (elbowLeft ? "left" : "right") << std::endl;
+        }
     }
+    return result;
+}
+
+/**
+ * @return The workspace grid, empty until loadWorkspace is called
+*/
+const WorkspaceGrid& SCARA::getWorkspace() const {
+    return this->workspace;
+}
+
+/**
+ * @return Tracer holding the duration of the pick and drop phases
+ */
+PhaseTracer& SCARA::getTracer() {
+    return this->tracer;
+}
+
+/**
+ * @return Monitor with the learned time to vacuum
+ */
+const VacuumMonitor& SCARA::getVacuumMonitor() const {
+    return this->vacuum;
+}
+
+/**
+ * Calculates the pose of the gripper from the joint positions.
+ * 
+ * @param j1 The angle of Joint 1 in degrees
+ * @param j2 The angle of Joint 2 in degrees
+ * @param j3 The position of the spindle-axis in mm
+ * @param j4 The gripper angle in degrees
+ * 
+ * @return The pose of the gripper
+ * 
+ * @note Inverse of calculateJointAngles, safe to call from the cycle thread
+ */
+Pose SCARA::calculatePose(double j1, double j2, double j3, double j4) const {
+    const double r1 = j1 * PI / 180.0;
+    const double r12 = (j1 + j2) * PI / 180.0;
+
+    Pose result;
+    result.x = a1 * cos(r1) + a2 * cos(r12);
+    result.y = a1 * sin(r1) + a2 * sin(r12);
+    result.z = j3;
+    result.angle = j1 + j2 - j4;
+    return result;
+}
+
+/**
+ * Uses a pose estimator to continue as soon as the gripper is close to its target.
+ * 
+ * @param poseEstimator The estimator, nullptr to wait for motion complete only
+ */
+void SCARA::setPoseEstimator(PoseEstimator* poseEstimator) {
+    this->estimator = poseEstimator;
+}
+
+/**
+ * Calculates the joint angles for many positions at once.
+ * 
+ * @param x The x coordinates of the end effector
+ * @param y The y coordinates of the end effector
+ * @param angle The angles of the objects
+ * @param n The number of positions
+ * @param out Both elbow solutions and the reachability of every position
+ * 
+ * @note Uses polynomial approximations, the angles are off by up to 0.01 degrees
+ */
+void SCARA::calculateJointAngles(const float* x, const float* y, const float* angle, size_t n, ik::Batch& out) {
+    ik::solve((float)a1, (float)a2, x, y, angle, n, out);
+}
+
+/**
+ * Acknowledges faults and enables powerstage for all slaves.
+ * 
+*/
+void SCARA::initSlaves() {
+    for (auto& ecSlave : this->ecSlaves) {
+        ecSlave.acknowledge_faults();
+        ecSlave.enable_powerstage();
+    } 
 }
 
 /**
@@ -102,20 +224,10 @@ void SCARA::moveToPos(Slave ecSlave, int slaveNr, int position, int velocity) {
  * @param velocityj1 The velocity to move Joint 1 with
  * @param velocityj2 The velocity to move Joint 2 with
  * 
+ * @note Both moves are queued in the master and run in parallel in the cycle thread
 */
 void SCARA::moveJ1J2(int j1, int j2, int velocityj1, int velocityj2) {
-    std::vector<std::thread> threads(2);
-
-    // Move slave for joint 1 to position j1
-    threads[0] = std::thread(&SCARA::moveToPos, this, ecSlaves[0], 1, j1, velocityj1);
-
-    // Move slave for joint 2 to position j2
-    threads[1] = std::thread(&SCARA::moveToPos, this, ecSlaves[1], 2, j2, velocityj2);
-
-    // Join both threads to wait for them to finish
-    for (int i = 0; i < 2; ++i) {  // Use the size of the threads vector
-        threads[i].join();
-    }
+    moveJoints(0, 1, j1, j2, velocityj1, velocityj2);
 }
 
 /**
@@ -125,23 +237,61 @@ void SCARA::moveJ1J2(int j1, int j2, int velocityj1, int velocityj2) {
  * @param j4 The target position for Joint 4
  * @param velocityj3 The velocity to move Joint 3 with
  * @param velocityj4 The velocity to move Joint 4 with
+ * @param whileMoving Called after the moves are started, before waiting for them to complete
  * 
+ * @note Both moves are queued in the master and run in parallel in the cycle thread
 */
-void SCARA::moveJ3J4(int j3, int j4, int velocityj3, int velocityj4) {
-    std::vector<std::thread> threads(2);
-
-    // Move slave for joint 3 to position j3
-    threads[0] = std::thread(&SCARA::moveToPos, this, ecSlaves[2], 3, j3, velocityj3);
-
-    // Move slave for joint 4 to position j4
-    threads[1] = std::thread(&SCARA::moveToPos, this, ecSlaves[3], 4, j4, velocityj4);
+void SCARA::moveJ3J4(int j3, int j4, int velocityj3, int velocityj4, std::function<void()> whileMoving) {
+    moveJoints(2, 3, j3, j4, velocityj3, velocityj4, whileMoving);
+}
 
-    // Join both threads to wait for them to finish
-    for (int i = 0; i < 2; ++i) {  // Use the size of the threads vector
-        threads[i].join();
+/**
+ * Moves two joints so they start and finish at the same time.
+ * 
+ * The given velocities are the limits, the joint with the shorter move is slowed
+ * down until both need the same time. Saves the wait for the slower joint at the
+ * end of every move.
+ * 
+ * @param first Index of the first joint in ecSlaves
+ * @param second Index of the second joint in ecSlaves
+ * @param targetFirst The target position for the first joint
+ * @param targetSecond The target position for the second joint
+ * @param velocityFirst The maximum velocity of the first joint
+ * @param velocitySecond The maximum velocity of the second joint
+ * @param whileMoving Called after the moves are started, before waiting for them to complete
+ * 
+ * @note The drives run their own profiles, the acceleration is assumed from RAMP_TIME
+*/
+void SCARA::moveJoints(int first, int second, int targetFirst, int targetSecond, int velocityFirst, int velocitySecond, std::function<void()> whileMoving) {
+    Trajectory move({limitsFor(velocityFirst), limitsFor(velocitySecond)}, {ecSlaves[first].getPos(), ecSlaves[second].getPos()});
+    move.add({targetFirst, targetSecond});
+    std::vector<ProfileMove> profile = move.profile(0);
+
+    // Joints that do not move keep their own velocity, 0 would reuse the previous one
+    std::future<int> firstDone = ecSlaves[first].submit(targetFirst, profile[0].velocity ? profile[0].velocity : velocityFirst);
+    std::future<int> secondDone = ecSlaves[second].submit(targetSecond, profile[1].velocity ? profile[1].velocity : velocitySecond);
+    if (whileMoving) whileMoving();
+
+    // Wait for both joints, also when the first one failed, so no move is left running
+    const int firstResult = firstDone.get();
+    const int secondResult = secondDone.get();
+    if (firstResult != EXIT_SUCCESS || secondResult != EXIT_SUCCESS) {
+        std::cerr << "Error: Moving joint " << first + 1 << " and joint " << second + 1 << " failed\n";
     }
 }
 
+/**
+ * Limits of a joint moving with a given maximum velocity.
+ * 
+ * @param velocity The maximum velocity in drive units per second
+ * 
+ * @return Limits with the acceleration and jerk assumed from RAMP_TIME
+*/
+JointLimits SCARA::limitsFor(int velocity) {
+    const double acceleration = velocity / RAMP_TIME;
+    return JointLimits{(double)velocity, acceleration, acceleration / (RAMP_TIME / 2)};
+}
+
 /**
  * Moves the robot to the home position.
  * 
@@ -155,6 +305,63 @@ void SCARA::moveTo0() {
     
 }
 
+/**
+ * Estimates the time to move from the current joint positions to a position.
+ * 
+ * @param x The x coordinate of the end effector
+ * @param y The y coordinate of the end effector
+ * @param angle The angle of the object
+ * @param elbowLeft True if the elbow is on the left side of the robot, false if it is on the right
+ * 
+ * @return Time in s of the slowest of Joint 1, 2 and 4, infinite if out of reach
+ * 
+ * @note Uses the velocities of macros_t and the ramps assumed from RAMP_TIME
+*/
+double SCARA::timeToReach(double x, double y, double angle, bool elbowLeft) {
+    const double unreachable = std::numeric_limits<double>::infinity();
+    if (!this->workspace.empty() && !this->workspace.reachable(x, y, elbowLeft)) return unreachable;
+
+    JointAngles angles = calculateJointAngles(x, y, angle, elbowLeft);
+    if (std::isnan(angles.j1) || std::isnan(angles.j2)) return unreachable;
+
+    const double j1 = DoubleS(J1Axis::toIncrements(units::Degrees(angles.j1)) - (double)ecSlaves[0].getPos(), limitsFor(j1speed)).duration();
+    const double j2 = DoubleS(J2Axis::toIncrements(units::Degrees(angles.j2)) - (double)ecSlaves[1].getPos(), limitsFor(j2speed)).duration();
+    const double j4 = DoubleS(J4Axis::toIncrements(units::Degrees(angles.gripper_angle)) - (double)ecSlaves[3].getPos(), limitsFor(j4speed)).duration();
+    return std::max(j1, std::max(j2, j4));
+}
+
+/**
+ * Selects the elbow configuration that reaches a position first.
+ * 
+ * Both inverse kinematics solutions are compared against the current joint
+ * positions. Solutions outside the joint ranges of the workspace grid are skipped.
+ * 
+ * @param x The x coordinate of the end effector
+ * @param y The y coordinate of the end effector
+ * @param angle The angle of the object
+ * 
+ * @return True for the elbow on the left side, false for the right side
+*/
+bool SCARA::selectElbow(double x, double y, double angle) {
+    const double left = timeToReach(x, y, angle, true);
+    const double right = timeToReach(x, y, angle, false);
+    if (left == right && !this->workspace.empty()) return this->workspace.preferLeft(x, y);
+    return left < right;
+}
+
+/**
+ * Picks up an object with the elbow configuration that gets there first.
+ * 
+ * @param x The x coordinate of the object
+ * @param y The y coordinate of the object
+ * @param angle The angle of the object
+ * 
+ * @return False if the object is out of reach, nothing is moved then, or if the vacuum did not seal
+*/
+bool SCARA::pickUp(double x, double y, double angle) {
+    return pickUp(x, y, angle, selectElbow(x, y, angle));
+}
+
 /**
  * Picks up an object.
  * 
@@ -163,13 +370,25 @@ void SCARA::moveTo0() {
  * @param angle The angle of the object
  * @param elbowLeft True if the elbow is on the left side of the robot, false if it is on the right
  * 
+ * @return False if the object is out of reach, nothing is moved then, or if the vacuum did not seal
 */
-void SCARA::pickUp(double x, double y, double angle, bool elbowLeft) {
+bool SCARA::pickUp(double x, double y, double angle, bool elbowLeft) {
+    int64_t t = PhaseTracer::now();
+
+    // Reject the object before any drive is commanded
+    if (!this->workspace.empty() && !this->workspace.reachable(x, y, elbowLeft)) {
+        std::cout << "Object at " << x << ", " << y << " out of reach" << std::endl;
+        return false;
+    }
     JointAngles angles = calculateJointAngles(x, y, angle, elbowLeft);
+    if (std::isnan(angles.j1) || std::isnan(angles.j2)) {
+        std::cout << "Object at " << x << ", " << y << " out of reach" << std::endl;
+        return false;
+    }
 
-    int j1pos = (int)angles.j1 * 1000; 
-    int j2pos = (int)angles.j2 * 1000;
-    int anglepos = (int)angles.gripper_angle * 1000;
+    int j1pos = J1Axis::toIncrements(units::Degrees(angles.j1));
+    int j2pos = J2Axis::toIncrements(units::Degrees(angles.j2));
+    int anglepos = J4Axis::toIncrements(units::Degrees(angles.gripper_angle));
 
     // Calculate the offset for the pick up position based on the x coordinate
     // In the searchfield the depth decreases by 4mm for every 340mm
@@ -186,74 +405,97 @@ void SCARA::pickUp(double x, double y, double angle, bool elbowLeft) {
         picklt = picklt + off;
     }
 
-    int apickupl = (int)picklt * 1000;
+    int apickupl = J3Axis::toIncrements(units::Millimetres(picklt));
+    t = this->tracer.record("pick.ik", t);
 
     // Move to the pick up position
     moveJ1J2(j1pos, j2pos, j1speed, j2speed);
+    t = this->tracer.record("pick.j1j2", t);
 
     // Move the spindle-axis to the pick up position
-    moveJ3J4(apickupl, anglepos,  j3speed, j4speed);
-    
-    airPressureOn();
-
-    Sleep(500);
-
-    // Wait for the vacuum to turn on
-    // This is done by checking the vacuum value every 100ms for 3 seconds
-    // If there is no vacuum after 3 seconds, the robot will continue
-    auto startTime = std::chrono::high_resolution_clock::now();
-    while (!getVacuum()) {
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        auto elapsedTime = std::chrono::duration_cast<std::chrono::seconds>(currentTime - startTime).count();
-
-        std::cout << "Waiting for vacuum" << std::endl;
-
-        // Break out of the loop if more than 3 seconds have passed
-        if (elapsedTime > 1.5) {
-            std::cout << "Timeout: Unable to detect vacuum within 3 seconds." << std::endl;
-            break;
-        }
-        // Sleep for a short duration to avoid high CPU usage in the loop
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (this->estimator) {
+        // Start the vacuum as soon as the gripper is close, not after the drives settled
+        Pose target = calculatePose(angles.j1, angles.j2, picklt, angles.gripper_angle);
+        moveJ3J4(apickupl, anglepos, j3speed, j4speed, [&]() {
+            if (!this->estimator->waitWithin(target, PICK_TOLERANCE, PICK_TIMEOUT)) {
+                std::cout << "Pick position not reached within " << PICK_TOLERANCE << " mm" << std::endl;
+            }
+            airPressureOn();
+        });
+    } else {
+        moveJ3J4(apickupl, anglepos,  j3speed, j4speed);
+        airPressureOn();
+    }
+    t = this->tracer.record("pick.descend", t);
+
+    // Lift as soon as the seal is confirmed, give up early when the vacuum takes far longer than usual
+    VacuumMonitor::result_t sealed = this->vacuum.wait(ecSlaves[this->apSlave - 1]);
+    t = this->tracer.record("pick.vacuum", t);
+    if (sealed == VacuumMonitor::no_seal) {
+        std::cout << "Timeout: Unable to detect vacuum within " << this->vacuum.getTimeout() << " ms." << std::endl;
+    } else if (sealed == VacuumMonitor::leak) {
+        std::cout << "Vacuum leaking at " << x << ", " << y << std::endl;
     }
+    if (sealed != VacuumMonitor::seal) airPressureOff();
 
     // Move the spindle-axis back up
     moveJ3J4(0, anglepos, j3speed, j4speed);
+    this->tracer.record("pick.lift", t);
+    return sealed == VacuumMonitor::seal;
 }
 
 /**
  * Drops an object.
  * 
  * @param elbowLeft True if the elbow is on the left side of the robot, false if it is on the right
+ * @param outOfView Called once the arm has left the camera field of view, before the object is dropped
  * 
  * @note the drop position is defined at x = 248.7, y = -381.9, angle = 70.0
  */
-void SCARA::drop(bool elbowLeft){
-    JointAngles dropangles = calculateJointAngles(248.7, -381.9, -70.0, elbowLeft);
+void SCARA::drop(bool elbowLeft, std::function<void()> outOfView){
+    int64_t t = PhaseTracer::now();
+    JointAngles dropangles = calculateJointAngles(dropX, dropY, dropAngle, elbowLeft);
 
-    int j1droppos = (int)dropangles.j1 * 1000;
-    int j2droppos = (int)dropangles.j2 * 1000;
-    int droppangle = (int)dropangles.gripper_angle * 1000;
+    int j1droppos = J1Axis::toIncrements(units::Degrees(dropangles.j1));
+    int j2droppos = J2Axis::toIncrements(units::Degrees(dropangles.j2));
+    int droppangle = J4Axis::toIncrements(units::Degrees(dropangles.gripper_angle));
+    t = this->tracer.record("drop.ik", t);
 
     moveJ1J2(j1droppos, j2droppos, j1speed, j2speed);
+    t = this->tracer.record("drop.j1j2", t);
+    if (outOfView) outOfView();
 
     moveJ3J4(dropl, droppangle, j3speed, j4speed);
+    t = this->tracer.record("drop.descend", t);
 
     airPressureOff();
 
-    while(getVacuum()){
+    // Wait for the vacuum to turn off, wait_inputs returns at once when the master leaves operation mode
+    Slave& airSlave = ecSlaves[this->apSlave - 1];
+    while (!airSlave.wait_inputs(VACUUM_INPUT, 0, EC_PROGRESSINTERVAL) && airSlave.connected()) {
         std::cout << "Waiting for vacuum to turn off" << std::endl;
     }
+    t = this->tracer.record("drop.release", t);
 
     moveJ3J4(0, droppangle, j3speed, j4speed);
+    this->tracer.record("drop.lift", t);
 }
+/**
+ * Drops an object with the elbow configuration that gets there first.
+ * 
+ * @param outOfView Called once the arm has left the camera field of view, before the object is dropped
+ */
+void SCARA::drop(std::function<void()> outOfView){
+    drop(selectElbow(dropX, dropY, dropAngle), outOfView);
+}
+
 /**
  * Turns on the air pressure.
  * 
 */
 void SCARA::airPressureOn(){
-    uint32_t airpressureon = 65536;
-    ecSlaves[this->apSlave - 1].write_sdo(0x60FE, 0x01, &airpressureon, sizeof(airpressureon));
+    ecSlaves[this->apSlave - 1].setOutputs(AIR_PRESSURE_OUTPUT, 0);
+    this->vacuum.start();
 }
 
 /**
@@ -261,8 +503,7 @@ void SCARA::airPressureOn(){
  * 
 */
 void SCARA::airPressureOff(){
-    uint32_t airpressureoff = 0;
-    ecSlaves[this->apSlave - 1].write_sdo(0x60FE, 0x01, &airpressureoff, sizeof(airpressureoff));
+    ecSlaves[this->apSlave - 1].setOutputs(0, AIR_PRESSURE_OUTPUT);
 }
 
 /**
@@ -272,20 +513,5 @@ void SCARA::airPressureOff(){
  * 
 */
 bool SCARA::getVacuum(){
-    uint32_t vacuum;
-    int vacuumsize = sizeof(vacuum);
-    ecSlaves[this->apSlave - 1].read_sdo(0x213D, 0x01, &vacuum, &vacuumsize);
-
-    // This number is based on the binary value of the I/O pins on the slave
-    if(vacuum == 12603140){
-        return false;
-    }
-    else if(vacuum == 12611332){
-        return true;
-    }
-    else{
-        std::cout << "Error: Invalid vacuum value" << std::endl;
-        return false;
-    }
-
+    return (ecSlaves[this->apSlave - 1].getInputs() & VACUUM_INPUT) != 0;
 }
\ No newline at end of file
@@ -6,8 +6,17 @@
 #include <vector>
 #include "slave.h"
 #include "master.h"
+#include "trajectory.h"
+#include "ik.h"
+#include "workspace.h"
+#include "units.h"
+#include "phasetracer.h"
+#include "vacuummonitor.h"
+#include <string>
 #include <thread>
 #include <chrono>
+#include <functional>
+#include <limits>
 
 struct JointAngles {
     double j1;
@@ -15,27 +24,67 @@ struct JointAngles {
     double gripper_angle;
 };
 
+/**
+ * @brief Cartesian pose of the gripper, position in mm and angle in degrees
+ */
+struct Pose {
+    double x;
+    double y;
+    double z;     // Depth of the spindle-axis, 0 is up
+    double angle; // Object angle, same meaning as the angle passed to pickUp
+};
+
+class PoseEstimator;
+
 class SCARA {
     private:
         double a1;  // Length of the first arm
         double a2;  // Length of the second arm
         std::vector<Slave>& ecSlaves;
         int apSlave; // Index of the slave that controls the air pressure
-        void moveToPos(Slave ecSlave, int slaveNr, int position, int velocity);
+        PoseEstimator* estimator = nullptr; // Live pose, optional
+        WorkspaceGrid workspace; // Reachable cells, checked before moving
+        PhaseTracer tracer; // Duration of every phase of pick and drop
+        VacuumMonitor vacuum; // Learns the time to vacuum
         void initSlaves();
+        void moveJoints(int first, int second, int targetFirst, int targetSecond, int velocityFirst, int velocitySecond, std::function<void()> whileMoving = nullptr);
         
     public:
+        // Position scaling of the drives, set by the fieldbus factors of the CMMT and compared by checkScaling
+        typedef units::DriveAxis<units::Angle, units::Millidegrees> J1Axis;
+        typedef units::DriveAxis<units::Angle, units::Millidegrees> J2Axis;
+        typedef units::DriveAxis<units::Length, units::Micrometres> J3Axis;
+        typedef units::DriveAxis<units::Angle, units::Millidegrees> J4Axis;
+
         SCARA(double length_a1, double length_a2, std::vector<Slave>& ecSlavesVec, int airPressureSlave);
         ~SCARA();
         JointAngles calculateJointAngles(double x, double y, double angle, bool elbowLeft);
-        void pickUp(double x, double y, double angle, bool elbowLeft);
+        Pose calculatePose(double j1, double j2, double j3, double j4) const;
+        void setPoseEstimator(PoseEstimator* poseEstimator);
+        JointRange getJointRange(int joint);
+        int checkScaling();
+        int loadWorkspace(const std::string& path);
+        const WorkspaceGrid& getWorkspace() const;
+        PhaseTracer& getTracer();
+        const VacuumMonitor& getVacuumMonitor() const;
+        void calculateJointAngles(const float* x, const float* y, const float* angle, size_t n, ik::Batch& out);
+        bool pickUp(double x, double y, double angle, bool elbowLeft);
+        bool pickUp(double x, double y, double angle);
+        bool selectElbow(double x, double y, double angle);
+        double timeToReach(double x, double y, double angle, bool elbowLeft);
         void airPressureOn();
         void airPressureOff();
         bool getVacuum();
         void moveJ1J2(int j1, int j2, int velocityj1, int velocityj2);
-        void moveJ3J4(int j3, int j4, int velocityj3, int velocityj4);
+        void moveJ3J4(int j3, int j4, int velocityj3, int velocityj4, std::function<void()> whileMoving = nullptr);
         void moveTo0();
-        void drop(bool elbowLeft);
+        void drop(bool elbowLeft, std::function<void()> outOfView = nullptr);
+        void drop(std::function<void()> outOfView);
+        static JointLimits limitsFor(int velocity);
+
+        static constexpr double dropX = 248.7; // Drop position in mm
+        static constexpr double dropY = -381.9;
+        static constexpr double dropAngle = -70.0; // Gripper angle at the drop position in degrees
 
     typedef enum {
         dropl = 170 * 1000, // Length of the spindel-axis to drop battery 168 mm * 1000
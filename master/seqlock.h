@@ -0,0 +1,51 @@
+// seqlock.h
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+/**
+ * @brief Sequence counter for data with a single writer and many readers
+ *
+ * The writer never waits: it makes the counter odd, writes, and makes it even again.
+ * Readers copy the data and retry when the counter was odd or changed meanwhile.
+ */
+class SeqLock {
+    public:
+        SeqLock() : seq(0) {}
+
+        void writeBegin(){
+            seq.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        void writeEnd(){
+            seq.fetch_add(1, std::memory_order_release);
+        }
+
+        // Wait until no write is in progress and return the sequence to validate against
+        uint32_t readBegin() const {
+            uint32_t s;
+            while ((s = seq.load(std::memory_order_acquire)) & 1) std::this_thread::yield();
+            return s;
+        }
+
+        // Non-blocking variant of readBegin, false if a write is in progress
+        bool tryReadBegin(uint32_t& s) const {
+            s = seq.load(std::memory_order_acquire);
+            return (s & 1) == 0;
+        }
+
+        // True if the data read since readBegin may be torn
+        bool readRetry(uint32_t s) const {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return seq.load(std::memory_order_relaxed) != s;
+        }
+
+    private:
+        std::atomic<uint32_t> seq;
+};
+
+#endif // SEQLOCK_H
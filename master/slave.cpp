@@ -120,6 +120,77 @@ int Slave::position_task(int32_t target, uint32_t velocity, uint32_t acceleratio
     return master.position_task(this->slaveNr, target, velocity, acceleration, deceleration, absolute, nonblocking);
 }
 
+/**
+ * Queue a position task without blocking
+ * 
+ * @param target Target position
+ * @param velocity Velocity, 0 keeps the velocity of the previous move
+ * @param absolute Absolute or relative(false) movement
+ * 
+ * @return Future that becomes EXIT_SUCCESS when the target is reached or EXIT_FAILURE
+ * @see submit from master
+ */
+std::future<int> Slave::submit(int32_t target, uint32_t velocity, bool absolute){
+    return master.submit({this->slaveNr, target, velocity, absolute});
+}
+
+/**
+ * Get the position of the drive
+ * 
+ * @return Position
+ * @see getPos from master
+ */
+int32_t Slave::getPos(){
+    return master.getPos(this->slaveNr);
+}
+
+/**
+ * Check if the master is still in operation mode
+ * 
+ * @return true while process data is exchanged
+ * @see connected from master
+ */
+bool Slave::connected(){
+    return master.connected();
+}
+
+/**
+ * Get the digital inputs of the drive
+ * 
+ * @return Value of 0x213D:01 in the last cycle
+ * @see getInputs from master
+ */
+uint32_t Slave::getInputs(){
+    return master.getInputs(this->slaveNr);
+}
+
+/**
+ * Set and clear digital outputs of the drive
+ * 
+ * @param set Output bits to set
+ * @param clear Output bits to clear
+ * 
+ * @return Staged value of 0x60FE:01
+ * @see setOutputs from master
+ */
+uint32_t Slave::setOutputs(uint32_t set, uint32_t clear){
+    return master.setOutputs(this->slaveNr, set, clear);
+}
+
+/**
+ * Wait until the masked digital inputs have a given value
+ * 
+ * @param mask Input bits to compare
+ * @param value Expected value of the masked bits
+ * @param timeout Timeout in milliseconds, 0 waits forever
+ * 
+ * @return true if the inputs have the value, false on timeout
+ * @see wait_inputs from master
+ */
+bool Slave::wait_inputs(uint32_t mask, uint32_t value, uint32_t timeout){
+    return master.wait_inputs(this->slaveNr, mask, value, timeout);
+}
+
 /**
  * @brief Wait for the target position to be reached
  * 
@@ -21,6 +21,12 @@ class Slave {
         int position_task(int32_t target, uint32_t velocity, bool absolute = false, bool nonblocking = false);
         int position_task(int32_t target, uint32_t velocity, uint32_t acceleration, uint32_t deceleration, bool absolute = false, bool nonblocking = false);
         bool wait_for_target_position();
+        std::future<int> submit(int32_t target, uint32_t velocity, bool absolute = true);
+        int32_t getPos();
+        bool connected();
+        uint32_t getInputs();
+        uint32_t setOutputs(uint32_t set, uint32_t clear);
+        bool wait_inputs(uint32_t mask, uint32_t value, uint32_t timeout = 0);
         int record_task(int32_t record);
         int velocity_task(int32_t velocity, float duration);
         void write_sdo(uint16 index, uint8 subindex, void *value, int valueSize);
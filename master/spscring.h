@@ -0,0 +1,60 @@
+// spscring.h
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief Lock-free ring buffer for one producer thread and one consumer thread
+ *
+ * Neither side ever waits: push fails when the ring is full and pop fails when
+ * it is empty.
+ *
+ * @tparam T Element type
+ * @tparam N Capacity, must be a power of two
+ */
+template<typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+        SpscRing() : head(0), tail(0) {}
+
+        // Producer side
+        bool push(const T& value){
+            const size_t h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) == N) return false;
+            buffer[h & (N - 1)] = value;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side
+        bool pop(T& value){
+            const size_t t = tail.load(std::memory_order_relaxed);
+            if (t == head.load(std::memory_order_acquire)) return false;
+            value = buffer[t & (N - 1)];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t size() const {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        }
+
+        size_t free() const {
+            return N - size();
+        }
+
+        static constexpr size_t capacity(){
+            return N;
+        }
+
+    private:
+        T buffer[N];
+        alignas(64) std::atomic<size_t> head; // Written by the producer
+        alignas(64) std::atomic<size_t> tail; // Written by the consumer
+};
+
+#endif // SPSCRING_H
@@ -0,0 +1,324 @@
+// trajectory.cpp
+#include "trajectory.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Constructor for a profile that does not move
+ */
+DoubleS::DoubleS() : distance(0), jerk(0), alim(0), vlim(0), Tj(0), Ta(0), Tv(0) {}
+
+/**
+ * Plan the fastest profile for a distance within the limits
+ *
+ * Follows the double S planning for a move from rest to rest: first assume the
+ * velocity limit is reached, if that leaves no cruise phase assume the acceleration
+ * limit is reached, if that fails neither limit is reached.
+ *
+ * @param distance Signed distance in drive units
+ * @param limits Velocity, acceleration and jerk limit, all positive
+ */
+DoubleS::DoubleS(double distance, const JointLimits& limits) : DoubleS() {
+    const double d = std::fabs(distance);
+    const double vmax = limits.velocity;
+    const double amax = limits.acceleration;
+    const double jmax = limits.jerk;
+    if (d == 0 || vmax <= 0 || amax <= 0 || jmax <= 0) return;
+
+    this->distance = distance;
+    this->jerk = jmax;
+
+    if (vmax * jmax >= amax * amax){
+        Tj = amax / jmax;
+        Ta = Tj + vmax / amax;
+    } else {
+        Tj = std::sqrt(vmax / jmax);
+        Ta = 2 * Tj;
+    }
+    Tv = d / vmax - Ta;
+
+    if (Tv < 0){
+        // Velocity limit not reached
+        Tv = 0;
+        Tj = amax / jmax;
+        Ta = (amax * amax / jmax + std::sqrt(std::pow(amax, 4) / (jmax * jmax) + 4 * amax * d)) / (2 * amax);
+        if (Ta < 2 * Tj){
+            // Acceleration limit not reached either
+            Tj = std::cbrt(d / (2 * jmax));
+            Ta = 2 * Tj;
+        }
+    }
+
+    alim = jmax * Tj;
+    vlim = (Ta - Tj) * alim;
+}
+
+/**
+ * @return Duration of the profile in s
+ */
+double DoubleS::duration() const {
+    return 2 * Ta + Tv;
+}
+
+/**
+ * Distance covered t seconds into the acceleration phase, without sign
+ */
+double DoubleS::ramp(double t) const {
+    if (t < Tj) return jerk * t * t * t / 6;
+    if (t < Ta - Tj) return alim / 6 * (3 * t * t - 3 * Tj * t + Tj * Tj);
+    const double left = Ta - t;
+    return vlim * Ta / 2 - vlim * left + jerk * left * left * left / 6;
+}
+
+/**
+ * Velocity t seconds into the acceleration phase, without sign
+ */
+double DoubleS::rampVelocity(double t) const {
+    if (t < Tj) return jerk * t * t / 2;
+    if (t < Ta - Tj) return alim * (t - Tj / 2);
+    const double left = Ta - t;
+    return vlim - jerk * left * left / 2;
+}
+
+/**
+ * Position on the profile
+ *
+ * @param t Time in s since the start of the profile
+ *
+ * @return Signed distance travelled, 0 before the start and the full distance after the end
+ */
+double DoubleS::position(double t) const {
+    const double T = duration();
+    if (t <= 0) return 0;
+    if (t >= T) return distance;
+
+    double q;
+    if (t < Ta) q = ramp(t);
+    else if (t < Ta + Tv) q = vlim * Ta / 2 + vlim * (t - Ta);
+    else q = std::fabs(distance) - ramp(T - t);
+    return distance < 0 ? -q : q;
+}
+
+/**
+ * Velocity on the profile
+ *
+ * @param t Time in s since the start of the profile
+ *
+ * @return Signed velocity in units per second
+ */
+double DoubleS::velocity(double t) const {
+    const double T = duration();
+    if (t <= 0 || t >= T) return 0;
+
+    double v;
+    if (t < Ta) v = rampVelocity(t);
+    else if (t < Ta + Tv) v = vlim;
+    else v = rampVelocity(T - t);
+    return distance < 0 ? -v : v;
+}
+
+/**
+ * @return Highest velocity of the profile, without sign
+ */
+double DoubleS::peakVelocity() const {
+    return vlim;
+}
+
+/**
+ * @return Highest acceleration of the profile, without sign
+ */
+double DoubleS::peakAcceleration() const {
+    return alim;
+}
+
+/**
+ * Constructor for an empty trajectory
+ *
+ * @param limits Limits of every joint
+ * @param start Position of every joint at the start of the trajectory
+ */
+Trajectory::Trajectory(const std::vector<JointLimits>& limits, const std::vector<int32_t>& start) : limits(limits), origin(start) {
+    this->origin.resize(limits.size(), 0);
+}
+
+/**
+ * Append a segment to a new target
+ *
+ * @param target Target position of every joint
+ * @param blend Time in s the segment may overlap with the previous one, limited to half of either segment
+ *
+ * @return Start time of the segment in s
+ * @note Overlapping profiles are added up, so during a blend a joint may exceed its
+ * velocity limit when both segments move it in the same direction
+ */
+double Trajectory::add(const std::vector<int32_t>& target, double blend){
+    Segment segment;
+    segment.target = target;
+    segment.target.resize(axes(), 0);
+
+    const std::vector<int32_t>& from = path.empty() ? origin : path.back().target;
+    segment.joints = synchronise(from, segment.target, segment.duration);
+
+    segment.start = 0;
+    if (!path.empty()){
+        const Segment& previous = path.back();
+        const double overlap = std::max(0.0, std::min({blend, previous.duration / 2, segment.duration / 2}));
+        segment.start = previous.start + previous.duration - overlap;
+    }
+    path.push_back(segment);
+    return segment.start;
+}
+
+/**
+ * Remove all segments, the trajectory starts from the last target afterwards
+ */
+void Trajectory::clear(){
+    if (!path.empty()) origin = path.back().target;
+    path.clear();
+}
+
+/**
+ * @return Number of joints
+ */
+size_t Trajectory::axes() const {
+    return limits.size();
+}
+
+/**
+ * @return Number of segments
+ */
+size_t Trajectory::segments() const {
+    return path.size();
+}
+
+/**
+ * @return Time in s until the last segment has finished
+ */
+double Trajectory::duration() const {
+    double end = 0;
+    for (const Segment& segment : path) end = std::max(end, segment.start + segment.duration);
+    return end;
+}
+
+/**
+ * Position of all joints
+ *
+ * @param t Time in s since the start of the trajectory
+ *
+ * @return Position of every joint in drive units
+ */
+std::vector<double> Trajectory::position(double t) const {
+    std::vector<double> result(origin.begin(), origin.end());
+    for (const Segment& segment : path){
+        if (t <= segment.start) break; // Segments are ordered by start time
+        for (size_t i = 0; i < axes(); i++) result[i] += segment.joints[i].position(t - segment.start);
+    }
+    return result;
+}
+
+/**
+ * Profile position parameters of one segment
+ *
+ * The drive runs a trapezoidal profile, so only the reached velocity and
+ * acceleration of the synchronised profile are handed over. The joints finish
+ * close together, but not as exactly as with @see stream.
+ *
+ * @param segment Index of the segment
+ *
+ * @return One absolute move per joint, velocity 0 for joints that do not move
+ */
+std::vector<ProfileMove> Trajectory::profile(size_t segment) const {
+    std::vector<ProfileMove> moves;
+    if (segment >= path.size()) return moves;
+
+    for (size_t i = 0; i < axes(); i++){
+        const DoubleS& joint = path[segment].joints[i];
+        ProfileMove move;
+        move.target = path[segment].target[i];
+        move.velocity = (uint32_t)std::lround(joint.peakVelocity());
+        move.acceleration = (uint32_t)std::lround(joint.peakAcceleration());
+        move.deceleration = move.acceleration;
+        moves.push_back(move);
+    }
+    return moves;
+}
+
+/**
+ * Stream the trajectory to drives in cyclic synchronous position mode
+ *
+ * Samples the trajectory every decimation cycles and lets the cycle thread
+ * interpolate in between. Blocks until all setpoints are written.
+ *
+ * @param master EtherCAT master
+ * @param slaves Slave number of every joint, each started with @see Master::csp_start
+ * @param decimation Cycles between two samples
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE if streaming stopped on one of the drives
+ * @note Setpoints are pushed drive by drive, the drives may start one cycle apart
+ */
+int Trajectory::stream(Master& master, const std::vector<int>& slaves, uint32_t decimation) const {
+    if (slaves.size() != axes()) return EXIT_FAILURE;
+    if (decimation == 0) decimation = 1;
+
+    const double period = master.getCycleTime() * 1e-6 * decimation;
+    const double end = duration();
+    const uint64_t samples = (uint64_t)std::ceil(end / period);
+
+    for (uint64_t k = 1; k <= samples; k++){
+        const std::vector<double> sample = position(std::min(k * period, end));
+        for (size_t i = 0; i < axes(); i++){
+            const CspSetpoint setpoint = {(int32_t)std::lround(sample[i]), decimation};
+            while (!master.csp_push(slaves[i], setpoint)){
+                if (!master.csp_active(slaves[i])) return EXIT_FAILURE;
+                master.waitCycle();
+            }
+        }
+    }
+
+    for (int slaveNr : slaves){
+        while (!master.csp_done(slaveNr)){
+            if (!master.csp_active(slaveNr)) return EXIT_FAILURE;
+            master.waitCycle();
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Plan the profiles of all joints for one segment with a common duration
+ *
+ * The duration of the slowest joint is taken, the velocity limit of every other
+ * joint is lowered by bisection until it needs the same time.
+ *
+ * @param from Start position of every joint
+ * @param to Target position of every joint
+ * @param duration Set to the duration of the segment in s
+ *
+ * @return Profile of every joint
+ */
+std::vector<DoubleS> Trajectory::synchronise(const std::vector<int32_t>& from, const std::vector<int32_t>& to, double& duration) const {
+    std::vector<DoubleS> joints;
+    duration = 0;
+    for (size_t i = 0; i < axes(); i++){
+        joints.emplace_back((double)to[i] - from[i], limits[i]);
+        duration = std::max(duration, joints[i].duration());
+    }
+
+    for (size_t i = 0; i < axes(); i++){
+        const double distance = (double)to[i] - from[i];
+        if (distance == 0 || joints[i].duration() >= duration) continue;
+
+        JointLimits slower = limits[i];
+        double low = 0;
+        double high = limits[i].velocity;
+        for (int step = 0; step < 50; step++){
+            slower.velocity = (low + high) / 2;
+            if (slower.velocity <= 0 || DoubleS(distance, slower).duration() > duration) low = slower.velocity;
+            else high = slower.velocity;
+        }
+        slower.velocity = high;
+        joints[i] = DoubleS(distance, slower);
+    }
+    return joints;
+}
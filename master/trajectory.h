@@ -0,0 +1,99 @@
+// trajectory.h
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <cstdint>
+#include <vector>
+#include "master.h"
+
+/**
+ * @brief Kinematic limits of one joint, in drive units
+ */
+struct JointLimits {
+    double velocity;     // Units per second
+    double acceleration; // Units per second^2
+    double jerk;         // Units per second^3
+};
+
+/**
+ * @brief Parameters to run one segment of a trajectory in profile position mode
+ */
+struct ProfileMove {
+    int32_t target;
+    uint32_t velocity;
+    uint32_t acceleration;
+    uint32_t deceleration;
+};
+
+/**
+ * @brief Jerk-limited (double S) point-to-point profile of one joint
+ *
+ * Starts and ends at rest, with seven phases of constant jerk. When the distance
+ * is too short the velocity or acceleration limit is not reached and the cruise
+ * or constant acceleration phase is left out.
+ */
+class DoubleS {
+    public:
+        DoubleS();
+        DoubleS(double distance, const JointLimits& limits);
+
+        double duration() const;
+        double position(double t) const; // Distance travelled at time t
+        double velocity(double t) const;
+        double peakVelocity() const;
+        double peakAcceleration() const;
+
+    private:
+        double distance; // Signed distance
+        double jerk;
+        double alim;     // Reached acceleration
+        double vlim;     // Reached velocity
+        double Tj;       // Duration of one constant jerk phase
+        double Ta;       // Duration of the acceleration (and deceleration) phase
+        double Tv;       // Duration of the cruise phase
+
+        double ramp(double t) const;         // Distance covered t seconds into the acceleration phase
+        double rampVelocity(double t) const; // Velocity t seconds into the acceleration phase
+};
+
+/**
+ * @brief Time-synchronised multi-joint trajectory
+ *
+ * Every segment moves all joints from the previous target to a new one. The
+ * slowest joint sets the segment duration, the velocity limit of the other joints
+ * is lowered until they need the same time, so all joints start and stop together.
+ * A segment may start before the previous one has finished: overlapping
+ * profiles are added up, which blends lift, traverse and descend moves without
+ * a full stop in between.
+ */
+class Trajectory {
+    public:
+        Trajectory(const std::vector<JointLimits>& limits, const std::vector<int32_t>& start);
+
+        double add(const std::vector<int32_t>& target, double blend = 0);
+        void clear();
+
+        size_t axes() const;
+        size_t segments() const;
+        double duration() const;
+        std::vector<double> position(double t) const;
+        std::vector<ProfileMove> profile(size_t segment) const;
+
+        int stream(Master& master, const std::vector<int>& slaves, uint32_t decimation = 1) const;
+
+    private:
+        struct Segment {
+            double start; // Start time in s relative to the start of the trajectory
+            double duration;
+            std::vector<DoubleS> joints;
+            std::vector<int32_t> target;
+        };
+
+        std::vector<JointLimits> limits;
+        std::vector<int32_t> origin;
+        std::vector<Segment> path;
+
+        std::vector<DoubleS> synchronise(const std::vector<int32_t>& from, const std::vector<int32_t>& to, double& duration) const;
+};
+
+#endif // TRAJECTORY_H
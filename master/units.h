@@ -0,0 +1,107 @@
+// units.h
+#ifndef UNITS_H
+#define UNITS_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <type_traits>
+
+namespace units {
+
+// Dimensions, a quantity only converts to quantities of the same dimension
+struct Angle { static constexpr uint8_t siUnit = 0x41; };  // Degree in the CiA 402 unit notation
+struct Length { static constexpr uint8_t siUnit = 0x01; }; // Metre in the CiA 402 unit notation
+
+constexpr int NOT_DECIMAL = 127;
+
+/**
+ * Power of ten of a scale, e.g. -3 for std::milli
+ *
+ * @return NOT_DECIMAL if the scale is no power of ten
+ */
+constexpr int decimalExponent(intmax_t num, intmax_t den){
+    int exponent = 0;
+    while (num > 1 && num % 10 == 0) { num /= 10; exponent++; }
+    while (den > 1 && den % 10 == 0) { den /= 10; exponent--; }
+    return num == 1 && den == 1 ? exponent : NOT_DECIMAL;
+}
+
+/**
+ * @brief Value with a dimension and a scale known at compile time
+ *
+ * Conversions between scales of the same dimension are implicit and exact up to
+ * double precision, mixing dimensions does not compile.
+ *
+ * @tparam Dim Dimension, Angle or Length
+ * @tparam Scale Size of one unit relative to the base unit (degree or metre)
+ */
+template<typename Dim, typename Scale = std::ratio<1>>
+class Quantity {
+    public:
+        typedef Dim dimension;
+        typedef Scale scale;
+
+        constexpr Quantity() : v(0) {}
+        constexpr explicit Quantity(double value) : v(value) {}
+
+        template<typename Other>
+        constexpr Quantity(const Quantity<Dim, Other>& other)
+            : v(other.value() * ((double)Other::num * Scale::den) / ((double)Other::den * Scale::num)) {}
+
+        constexpr double value() const { return v; }
+
+        constexpr Quantity operator+(const Quantity& other) const { return Quantity(v + other.v); }
+        constexpr Quantity operator-(const Quantity& other) const { return Quantity(v - other.v); }
+        constexpr Quantity operator-() const { return Quantity(-v); }
+        constexpr Quantity operator*(double factor) const { return Quantity(v * factor); }
+        constexpr bool operator<(const Quantity& other) const { return v < other.v; }
+        constexpr bool operator>(const Quantity& other) const { return v > other.v; }
+
+    private:
+        double v;
+};
+
+typedef Quantity<Angle> Degrees;
+typedef Quantity<Angle, std::milli> Millidegrees;
+typedef Quantity<Length> Metres;
+typedef Quantity<Length, std::milli> Millimetres;
+typedef Quantity<Length, std::micro> Micrometres;
+
+/**
+ * @brief Position scaling of one drive
+ *
+ * Matches the fieldbus factor group of the CMMT, which sets the size of one
+ * position increment on the bus.
+ *
+ * @tparam Dim Dimension of the axis
+ * @tparam Increment Quantity of one increment, e.g. Millidegrees
+ */
+template<typename Dim, typename Increment>
+struct DriveAxis {
+    static_assert(std::is_same<Dim, typename Increment::dimension>::value, "Increment has another dimension than the axis");
+    static_assert(decimalExponent(Increment::scale::num, Increment::scale::den) != NOT_DECIMAL, "Increment is no decimal unit");
+
+    // Value of the SI unit position (0x60A8) of a drive with this scaling, prefix in the top byte and unit below
+    static constexpr uint32_t siUnitPosition(){
+        return ((uint32_t)(uint8_t)(int8_t)decimalExponent(Increment::scale::num, Increment::scale::den) << 24) | ((uint32_t)Dim::siUnit << 16);
+    }
+
+    // Nearest increment, saturated to the range of the drive
+    template<typename Scale>
+    static int32_t toIncrements(const Quantity<Dim, Scale>& position){
+        const double increments = std::round(Increment(position).value());
+        if (increments >= (double)std::numeric_limits<int32_t>::max()) return std::numeric_limits<int32_t>::max();
+        if (increments <= (double)std::numeric_limits<int32_t>::min()) return std::numeric_limits<int32_t>::min();
+        return (int32_t)increments;
+    }
+
+    static Increment fromIncrements(int32_t increments){
+        return Increment((double)increments);
+    }
+};
+
+} // namespace units
+
+#endif // UNITS_H
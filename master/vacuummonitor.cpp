@@ -0,0 +1,108 @@
+// vacuummonitor.cpp
+#include "vacuummonitor.h"
+
+#include <algorithm>
+#include <cmath>
+#include "cyclescheduler.h"
+
+/**
+ * Constructor for a monitor that has not learned anything yet
+ *
+ * @param input Bit of the vacuum switch on the digital inputs
+ * @param timeout Longest time in ms to wait for the vacuum
+ */
+VacuumMonitor::VacuumMonitor(uint32_t input, uint32_t timeout)
+    : input(input), timeout(timeout), started(0), mean(0), deviation(0), seals(0), failures(0) {}
+
+/**
+ * Remember when the air was switched on, the time to vacuum counts from here
+ */
+void VacuumMonitor::start(){
+    started = CycleScheduler::now();
+}
+
+/**
+ * Wait until the vacuum switch confirms the seal
+ *
+ * Returns as soon as the switch stayed on for DEBOUNCE ms. Only seals are
+ * learned, so a run of empty picks does not stretch the timeout.
+ *
+ * @param slave Slave with the vacuum switch on its digital inputs
+ *
+ * @return seal, or the reason there is none
+ */
+VacuumMonitor::result_t VacuumMonitor::wait(Slave& slave){
+    if (started == 0) start();
+    const int64_t deadline = started + (int64_t)getTimeout() * 1000000;
+
+    int bounces = 0;
+    while (true) {
+        const int64_t left = deadline - CycleScheduler::now();
+        if (left <= 0) break;
+
+        // Round up, a timeout of 0 would wait forever
+        const uint32_t milliseconds = (uint32_t)((left + 999999) / 1000000);
+        if (!slave.wait_inputs(input, input, milliseconds)) {
+            if (CycleScheduler::now() < deadline) return stopped;
+            break;
+        }
+        const int64_t rise = CycleScheduler::now();
+
+        // Stable if it does not fall within the debounce time
+        if (!slave.wait_inputs(input, 0, DEBOUNCE)) {
+            if ((slave.getInputs() & input) == 0) return stopped;
+            learn((rise - started) / 1e6);
+            seals++;
+            started = 0;
+            return seal;
+        }
+        if (++bounces >= MAX_BOUNCES) {
+            failures++;
+            started = 0;
+            return leak;
+        }
+    }
+    failures++;
+    started = 0;
+    return no_seal;
+}
+
+/**
+ * @return Time in ms after start to give up on the vacuum
+ */
+uint32_t VacuumMonitor::getTimeout() const {
+    if (seals < LEARN_SEALS) return timeout;
+    const double learned = std::ceil(mean + 4 * deviation);
+    return (uint32_t)std::min<double>(timeout, std::max<double>(MIN_TIMEOUT, learned));
+}
+
+double VacuumMonitor::getMean() const {
+    return mean;
+}
+
+double VacuumMonitor::getDeviation() const {
+    return deviation;
+}
+
+uint64_t VacuumMonitor::getSeals() const {
+    return seals;
+}
+
+uint64_t VacuumMonitor::getFailures() const {
+    return failures;
+}
+
+/**
+ * Add a time to vacuum to the averages, with the gains of RFC 6298
+ *
+ * @param milliseconds Time from start to the switch turning on
+ */
+void VacuumMonitor::learn(double milliseconds){
+    if (seals == 0) {
+        mean = milliseconds;
+        deviation = milliseconds / 2;
+        return;
+    }
+    deviation = 0.75 * deviation + 0.25 * std::abs(mean - milliseconds);
+    mean = 0.875 * mean + 0.125 * milliseconds;
+}
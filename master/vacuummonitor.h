@@ -0,0 +1,54 @@
+// vacuummonitor.h
+#ifndef VACUUMMONITOR_H
+#define VACUUMMONITOR_H
+
+#include <cstdint>
+#include "slave.h"
+
+/**
+ * @brief Confirms the seal of the vacuum gripper as soon as the switch settles
+ *
+ * The time from switching the air on to the vacuum switch turning on is learned
+ * with a moving average and mean deviation, like a TCP retransmission timeout.
+ * Once enough seals were seen the wait gives up when the switch stays off far
+ * longer than usual, instead of always waiting for the worst case. A switch that
+ * turns on and falls again within the debounce time is a leaking seal.
+ */
+class VacuumMonitor {
+    public:
+        typedef enum {
+            seal,    // Switch on and stable for the debounce time
+            no_seal, // Switch stayed off until the deadline, nothing under the gripper
+            leak,    // Switch kept falling again, the seal is not tight
+            stopped, // The master left OP
+        }result_t;
+
+        static constexpr uint32_t DEBOUNCE = 20;  // Time in ms the switch has to stay on
+        static constexpr uint32_t MIN_TIMEOUT = 150; // Time in ms never to give up before
+        static constexpr int LEARN_SEALS = 8;     // Seals to see before the timeout adapts
+        static constexpr int MAX_BOUNCES = 3;     // Falls of the switch before it is a leak
+
+        VacuumMonitor(uint32_t input, uint32_t timeout);
+
+        void start(); // Call when the air is switched on
+        result_t wait(Slave& slave);
+
+        uint32_t getTimeout() const; // Current deadline in ms after start
+        double getMean() const;      // Average time to vacuum in ms
+        double getDeviation() const; // Mean deviation of the time to vacuum in ms
+        uint64_t getSeals() const;
+        uint64_t getFailures() const;
+
+    private:
+        uint32_t input;   // Bit of the vacuum switch on the digital inputs
+        uint32_t timeout; // Worst case in ms, used until the timeout adapted
+        int64_t started;  // Time the air was switched on in ns
+        double mean;
+        double deviation;
+        uint64_t seals;
+        uint64_t failures;
+
+        void learn(double milliseconds);
+};
+
+#endif // VACUUMMONITOR_H
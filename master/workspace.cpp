@@ -0,0 +1,195 @@
+// workspace.cpp
+#include "workspace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "ik.h"
+
+const char WORKSPACE_MAGIC[4] = {'W', 'S', 'G', 'R'};
+const uint32_t WORKSPACE_VERSION = 1;
+
+/**
+ * Constructor for an empty grid, nothing is reachable until it is built or loaded
+ */
+WorkspaceGrid::WorkspaceGrid() : header(), origin(0) {}
+
+/**
+ * Calculate the reachability of every cell
+ *
+ * @param a1 Length of the first arm in mm
+ * @param a2 Length of the second arm in mm
+ * @param j1 Range of Joint 1
+ * @param j2 Range of Joint 2
+ * @param cell Edge length of a cell in mm
+ */
+void WorkspaceGrid::build(float a1, float a2, const JointRange& j1, const JointRange& j2, float cell){
+    std::memcpy(header.magic, WORKSPACE_MAGIC, sizeof(header.magic));
+    header.version = WORKSPACE_VERSION;
+    header.a1 = a1;
+    header.a2 = a2;
+    header.j1 = j1;
+    header.j2 = j2;
+    header.cell = cell;
+    header.size = (uint32_t)std::ceil(2 * (a1 + a2) / cell);
+    origin = -(a1 + a2);
+
+    const uint32_t n = header.size;
+    cells.assign((size_t)n * n, 0);
+
+    // One row of cell centres per batch
+    std::vector<float> x(n), y(n), angle(n, 0.0f);
+    for (uint32_t c = 0; c < n; c++) x[c] = origin + (c + 0.5f) * cell;
+    ik::Batch solutions;
+
+    auto margin = [](float angle, const JointRange& range) {
+        return std::min(angle - range.min, range.max - angle);
+    };
+
+    for (uint32_t r = 0; r < n; r++){
+        std::fill(y.begin(), y.end(), origin + (r + 0.5f) * cell);
+        ik::solve(a1, a2, x.data(), y.data(), angle.data(), n, solutions);
+
+        for (uint32_t c = 0; c < n; c++){
+            if (!solutions.reachable[c]) continue;
+            const float left = std::min(margin(solutions.j1Left[c], j1), margin(solutions.j2Left[c], j2));
+            const float right = std::min(margin(solutions.j1Right[c], j1), margin(solutions.j2Right[c], j2));
+
+            uint8_t flags = 0;
+            if (left >= 0) flags |= reach_left;
+            if (right >= 0) flags |= reach_right;
+            if (left >= 0 && left > right) flags |= prefer_left;
+            cells[(size_t)r * n + c] = flags;
+        }
+    }
+}
+
+/**
+ * Write the grid to a file
+ *
+ * @param path File to write
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int WorkspaceGrid::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Error: Cannot write workspace grid " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)cells.data(), cells.size());
+    return file.good() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Read a grid from a file
+ *
+ * @param path File to read
+ * @param a1 Length of the first arm in mm
+ * @param a2 Length of the second arm in mm
+ * @param j1 Range of Joint 1
+ * @param j2 Range of Joint 2
+ * @param cell Edge length of a cell in mm
+ *
+ * @return EXIT_SUCCESS, EXIT_FAILURE if the file is missing, damaged or built for other parameters
+ */
+int WorkspaceGrid::load(const std::string& path, float a1, float a2, const JointRange& j1, const JointRange& j2, float cell){
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return EXIT_FAILURE;
+
+    Header stored;
+    if (!file.read((char*)&stored, sizeof(stored))) return EXIT_FAILURE;
+
+    Header wanted = {};
+    std::memcpy(wanted.magic, WORKSPACE_MAGIC, sizeof(wanted.magic));
+    wanted.version = WORKSPACE_VERSION;
+    wanted.a1 = a1;
+    wanted.a2 = a2;
+    wanted.j1 = j1;
+    wanted.j2 = j2;
+    wanted.cell = cell;
+    wanted.size = (uint32_t)std::ceil(2 * (a1 + a2) / cell);
+    header = stored;
+    if (!matches(wanted)) {
+        header = Header();
+        return EXIT_FAILURE;
+    }
+
+    cells.resize((size_t)stored.size * stored.size);
+    if (!file.read((char*)cells.data(), cells.size())) {
+        header = Header();
+        cells.clear();
+        return EXIT_FAILURE;
+    }
+    origin = -(a1 + a2);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Load the grid, build and save it when the file does not fit
+ *
+ * @return EXIT_SUCCESS, EXIT_FAILURE if the grid was built but could not be saved
+ */
+int WorkspaceGrid::loadOrBuild(const std::string& path, float a1, float a2, const JointRange& j1, const JointRange& j2, float cell){
+    if (load(path, a1, a2, j1, j2, cell) == EXIT_SUCCESS) return EXIT_SUCCESS;
+    std::cout << "Building workspace grid " << path << std::endl;
+    build(a1, a2, j1, j2, cell);
+    return save(path);
+}
+
+/**
+ * @return true if the grid was neither built nor loaded
+ */
+bool WorkspaceGrid::empty() const {
+    return cells.empty();
+}
+
+/**
+ * Flags of the cell containing a position
+ *
+ * @param x X coordinate in mm
+ * @param y Y coordinate in mm
+ *
+ * @return Combination of cell_t, 0 if unreachable or outside the grid
+ */
+uint8_t WorkspaceGrid::at(double x, double y) const {
+    if (cells.empty()) return 0;
+    const double c = std::floor((x - origin) / header.cell);
+    const double r = std::floor((y - origin) / header.cell);
+    if (c < 0 || r < 0 || c >= header.size || r >= header.size) return 0;
+    return cells[(size_t)r * header.size + (size_t)c];
+}
+
+/**
+ * @return true if a position is reachable with any elbow configuration
+ */
+bool WorkspaceGrid::reachable(double x, double y) const {
+    return (at(x, y) & (reach_left | reach_right)) != 0;
+}
+
+/**
+ * @return true if a position is reachable with the given elbow configuration
+ */
+bool WorkspaceGrid::reachable(double x, double y, bool elbowLeft) const {
+    return (at(x, y) & (elbowLeft ? reach_left : reach_right)) != 0;
+}
+
+/**
+ * @return true if the elbow left configuration is the better one for a position
+ */
+bool WorkspaceGrid::preferLeft(double x, double y) const {
+    return (at(x, y) & prefer_left) != 0;
+}
+
+/**
+ * Compare the parameters a grid was built for
+ */
+bool WorkspaceGrid::matches(const Header& other) const {
+    return std::memcmp(header.magic, other.magic, sizeof(header.magic)) == 0 && header.version == other.version
+        && header.a1 == other.a1 && header.a2 == other.a2 && header.j1.min == other.j1.min && header.j1.max == other.j1.max
+        && header.j2.min == other.j2.min && header.j2.max == other.j2.max && header.cell == other.cell && header.size == other.size;
+}
@@ -0,0 +1,65 @@
+// workspace.h
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Allowed range of a joint in degrees
+ */
+struct JointRange {
+    float min;
+    float max;
+};
+
+/**
+ * @brief Reachability of every cell of the workspace, looked up in constant time
+ *
+ * Covers a square of twice the arm reach around the base. A cell is reachable
+ * with an elbow configuration when the inverse kinematics of its centre has a
+ * solution within the joint ranges. The grid is saved and loaded again at the
+ * next start as long as arm lengths, joint ranges and cell size match.
+ */
+class WorkspaceGrid {
+    public:
+        typedef enum {
+            reach_left = 1,  // Reachable with the elbow left
+            reach_right = 2, // Reachable with the elbow right
+            prefer_left = 4, // Elbow left keeps more distance to the joint limits
+        }cell_t;
+
+        WorkspaceGrid();
+
+        void build(float a1, float a2, const JointRange& j1, const JointRange& j2, float cell = 2.0f);
+        int save(const std::string& path) const;
+        int load(const std::string& path, float a1, float a2, const JointRange& j1, const JointRange& j2, float cell = 2.0f);
+        int loadOrBuild(const std::string& path, float a1, float a2, const JointRange& j1, const JointRange& j2, float cell = 2.0f);
+
+        bool empty() const;
+        uint8_t at(double x, double y) const; // Flags of the cell, 0 outside the grid
+        bool reachable(double x, double y) const;
+        bool reachable(double x, double y, bool elbowLeft) const;
+        bool preferLeft(double x, double y) const;
+
+    private:
+        struct Header {
+            char magic[4];
+            uint32_t version;
+            float a1;
+            float a2;
+            JointRange j1;
+            JointRange j2;
+            float cell;
+            uint32_t size; // Cells per row and column
+        };
+
+        Header header;
+        float origin; // Coordinate of the lower edge of the grid in x and y
+        std::vector<uint8_t> cells; // Row by row, y outer
+
+        bool matches(const Header& other) const;
+};
+
+#endif // WORKSPACE_H